@@ -0,0 +1,441 @@
+// File Name : analyze.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : predicts how well files would compress with each engine
+//               from their byte histograms alone, without encoding
+// Data : 04/12/2022
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "archive.h"
+#include "blockfile.h"
+#include "codebook.h"
+#include "codebookcache.h"
+#include "histogram.h"
+#include "pipeline.h"
+
+using namespace std;
+
+const int N_ANALYZE_BLOCKS = 4;
+const long ANALYZE_BLOCK_SIZES[N_ANALYZE_BLOCKS] = {
+    256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024
+};
+const int MAX_ANALYZE_LENGTH = 64;  // longest code MAX_TREE_TOTAL allows
+
+struct FileAnalysis {
+    string name;
+    long size;  // bytes in the file
+    long analyzed;  // bytes counted: the file or its prefix
+    long counts[BYTE_VALUES];
+    double entropy;  // order 0 entropy in bits per byte
+    long hufSize;  // predicted size of compress() output
+    long codebookSize;  // predicted size with the builtin codebook, or -1
+    long blockSizes[N_ANALYZE_BLOCKS];  // predicted .hufb size per block size
+    long lengthSymbols[MAX_ANALYZE_LENGTH + 1];  // symbols per code length
+    long lengthBytes[MAX_ANALYZE_LENGTH + 1];  // bytes coded per code length
+};
+
+//
+// *This function returns the order 0 entropy of counts in bits per byte.
+//
+double shannonEntropy(const long counts[]) {
+    long total = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        total += counts[b];
+    }
+    double bits = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        if (counts[b] > 0) {
+            double p = (double)counts[b] / total;
+            bits -= p * log2(p);
+        }
+    }
+    return bits;
+}
+
+//
+// *This function sets lengths[b] to the length of byte b's Huffman code for
+// counts, with PSEUDO_EOF counted once as compress() does, and returns the
+// length of the PSEUDO_EOF code.  Bytes that never occur get length 0.  Ties
+// may be broken differently from buildEncodingTree(), but every Huffman
+// tree of the same counts codes them in the same number of bits, which is
+// all the predictions use.  Works on arrays so no nodes are allocated.
+//
+int huffmanLengths(const long counts[], int lengths[]) {
+    typedef pair<long, int> Item;  // count, node
+    priority_queue<Item, vector<Item>, greater<Item> > queue;
+    vector<int> parent;
+    for (int b = 0; b <= BYTE_VALUES; b++) {
+        long count = (b == BYTE_VALUES) ? 1 : counts[b];
+        if (b < BYTE_VALUES) {
+            lengths[b] = 0;
+        }
+        parent.push_back(-1);
+        if (count > 0) {
+            queue.push(make_pair(count, b));
+        }
+    }
+    while (queue.size() > 1) {
+        Item a = queue.top();
+        queue.pop();
+        Item b = queue.top();
+        queue.pop();
+        int node = parent.size();
+        parent.push_back(-1);
+        parent[a.second] = node;
+        parent[b.second] = node;
+        queue.push(make_pair(a.first + b.first, node));
+    }
+    int eofLength = 0;
+    for (int b = 0; b <= BYTE_VALUES; b++) {
+        int length = 0;
+        for (int n = b; parent[n] >= 0; n = parent[n]) {
+            length++;
+        }
+        if (b == BYTE_VALUES) {
+            eofLength = length;
+        } else if (counts[b] > 0) {
+            lengths[b] = length;
+        }
+    }
+    return eofLength;
+}
+
+//
+// *This function returns the predicted size of one block of a block file:
+// its record, its payload (raw if coding does not pay, see codeBlock) and
+// its index entry.  Raw blocks have no seek points.
+//
+long predictBlock(const long counts[], long length, long seekInterval) {
+    int lengths[BYTE_VALUES];
+    huffmanLengths(counts, lengths);
+    long bits = 0;
+    long nSymbols = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        bits += counts[b] * lengths[b];
+        nSymbols += (counts[b] > 0);
+    }
+    long coded = 2 + 5 * nSymbols + (bits + 7) / 8;
+    if (coded >= length) {
+        return BLOCK_RECORD_SIZE + length + 20;  // raw, no seek points
+    }
+    long seekPoints = (length + seekInterval - 1) / seekInterval;
+    return BLOCK_RECORD_SIZE + coded + 20 + 4 * seekPoints;
+}
+
+//
+// *This function counts length bytes of data into counts and adds the
+// predicted size of their blocks at every analyzed block size to
+// blockSizes.  data must start on a boundary of the largest block size so
+// the blocks match the ones compressBlocks would cut.
+//
+void analyzeRange(const char* data, long length, long counts[],
+                  long blockSizes[]) {
+    const long step = ANALYZE_BLOCK_SIZES[0];
+    long partial[N_ANALYZE_BLOCKS][BYTE_VALUES] = {{0}};
+    long chunk[BYTE_VALUES];
+    for (long begin = 0; begin < length; begin += step) {
+        long n = min(step, length - begin);
+        fill(chunk, chunk + BYTE_VALUES, 0L);
+        countBytesUnrolled(data + begin, n, chunk);
+        mergeCounts(counts, chunk);
+        for (int s = 0; s < N_ANALYZE_BLOCKS; s++) {
+            mergeCounts(partial[s], chunk);
+            long blockSize = ANALYZE_BLOCK_SIZES[s];
+            long end = begin + n;
+            if (end % blockSize == 0 || end == length) {
+                long blockLength = end - (end - 1) / blockSize * blockSize;
+                blockSizes[s] += predictBlock(partial[s], blockLength,
+                                              DEFAULT_SEEK_INTERVAL);
+                fill(partial[s], partial[s] + BYTE_VALUES, 0L);
+            }
+        }
+    }
+}
+
+//
+// *This function returns the number of characters the frequency map
+// header of compress() takes for counts.
+//
+long hufHeaderSize(const long counts[]) {
+    long size = 2 + to_string(PSEUDO_EOF).size() + 2;  // "{" "}" and 256:1
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        if (counts[b] > 0) {
+            size += to_string((int)(char)b).size() + 1
+                    + to_string(counts[b]).size() + 2;
+        }
+    }
+    return size;
+}
+
+//
+// *This function fills the predictions of analysis from its counts; the
+// block predictions are already made.
+//
+void finishAnalysis(FileAnalysis &analysis) {
+    int lengths[BYTE_VALUES];
+    int eofLength = huffmanLengths(analysis.counts, lengths);
+    fill(analysis.lengthSymbols,
+         analysis.lengthSymbols + MAX_ANALYZE_LENGTH + 1, 0L);
+    fill(analysis.lengthBytes, analysis.lengthBytes + MAX_ANALYZE_LENGTH + 1,
+         0L);
+    long bits = eofLength;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        if (analysis.counts[b] > 0) {
+            int length = min(lengths[b], MAX_ANALYZE_LENGTH);
+            analysis.lengthSymbols[length]++;
+            analysis.lengthBytes[length] += analysis.counts[b];
+            bits += analysis.counts[b] * lengths[b];
+        }
+    }
+    analysis.entropy = shannonEntropy(analysis.counts);
+    analysis.hufSize = hufHeaderSize(analysis.counts) + (bits + 7) / 8;
+    Codebook* book = getCodebook(1);
+    double codebookBits = (book == nullptr) ? -1
+                          : tableCodedBits(analysis.counts, book->table);
+    // '@', the id and hash, then the bytes and PSEUDO_EOF
+    analysis.codebookSize = (codebookBits < 0) ? -1
+        : 1 + CODEBOOK_REF_SIZE
+          + ((long)codebookBits + book->table[PSEUDO_EOF].length + 7) / 8;
+    long index = BLOCKFILE_HEADER_SIZE + BLOCKFILE_TRAILER_SIZE;
+    for (int s = 0; s < N_ANALYZE_BLOCKS; s++) {
+        analysis.blockSizes[s] += index;
+    }
+}
+
+//
+// *This function analyzes the first prefix bytes of filename (all of it if
+// prefix is 0) on nThreads threads.  Throws if it cannot be read.
+//
+FileAnalysis analyzeFile(string filename, long prefix, int nThreads) {
+    FileAnalysis analysis = FileAnalysis();
+    analysis.name = filename;
+    int fd = openFile(filename, O_RDONLY);
+    struct stat info;
+    fstat(fd, &info);
+    analysis.size = info.st_size;
+    analysis.analyzed = (prefix > 0) ? min(prefix, analysis.size)
+                        : analysis.size;
+    const char* data = nullptr;
+    if (analysis.analyzed > 0) {
+        void* mapped = mmap(nullptr, analysis.analyzed, PROT_READ,
+                            MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Cannot map " + filename);
+        }
+        madvise(mapped, analysis.analyzed, MADV_SEQUENTIAL);
+        data = (const char*)mapped;
+    }
+    close(fd);
+
+    // threads take whole blocks of the largest size so no block is split
+    const long unit = ANALYZE_BLOCK_SIZES[N_ANALYZE_BLOCKS - 1];
+    long nUnits = (analysis.analyzed + unit - 1) / unit;
+    nThreads = max(1, (int)min((long)nThreads, nUnits));
+    long share = (nUnits + nThreads - 1) / nThreads * unit;
+    vector<vector<long> > counts(nThreads, vector<long>(BYTE_VALUES));
+    vector<vector<long> > blockSizes(nThreads,
+                                     vector<long>(N_ANALYZE_BLOCKS));
+    auto work = [&](int t) {
+        long begin = min(analysis.analyzed, t * share);
+        long end = min(analysis.analyzed, begin + share);
+        analyzeRange(data + begin, end - begin, counts[t].data(),
+                     blockSizes[t].data());
+    };
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++) {
+        threads.push_back(thread(work, t));
+    }
+    if (analysis.analyzed > 0) {
+        work(0);
+    }
+    for (thread &worker : threads) {
+        worker.join();
+    }
+    for (int t = 0; t < nThreads; t++) {
+        mergeCounts(analysis.counts, counts[t].data());
+        for (int s = 0; s < N_ANALYZE_BLOCKS; s++) {
+            analysis.blockSizes[s] += blockSizes[t][s];
+        }
+    }
+    if (data != nullptr) {
+        munmap((void*)data, analysis.analyzed);
+    }
+    finishAnalysis(analysis);
+    return analysis;
+}
+
+//
+// *This function analyzes every file below path, or path itself if it is a
+// file.  Files of at least MIN_THREAD_BYTES are analyzed one at a time on
+// all nThreads threads; smaller files are spread over the threads.
+//
+vector<FileAnalysis> analyzePath(string path, long prefix, int nThreads) {
+    vector<string> files;
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        throw runtime_error("Cannot open " + path);
+    }
+    if (S_ISDIR(info.st_mode)) {
+        listFiles(path, "", files);
+        for (string &file : files) {
+            file = path + "/" + file;
+        }
+    } else {
+        files.push_back(path);
+    }
+    sort(files.begin(), files.end());
+    getCodebook(1);  // loaded once here, not by every thread
+
+    vector<FileAnalysis> results(files.size());
+    vector<bool> ok(files.size(), false);
+    vector<size_t> small;
+    for (size_t i = 0; i < files.size(); i++) {
+        long size = (stat(files[i].c_str(), &info) == 0) ? info.st_size : 0;
+        if (min(size, prefix > 0 ? prefix : size) >= MIN_THREAD_BYTES) {
+            try {
+                results[i] = analyzeFile(files[i], prefix, nThreads);
+                ok[i] = true;
+            } catch (runtime_error &e) {
+                cout << e.what() << endl;
+            }
+        } else {
+            small.push_back(i);
+        }
+    }
+    atomic<size_t> next(0);
+    vector<thread> threads;
+    for (int t = 0; t < max(1, nThreads); t++) {
+        threads.push_back(thread([&]() {
+            size_t k;
+            while ((k = next++) < small.size()) {
+                try {
+                    results[small[k]] = analyzeFile(files[small[k]], prefix, 1);
+                    ok[small[k]] = true;
+                } catch (runtime_error &) {
+                    // reported below as unreadable
+                }
+            }
+        }));
+    }
+    for (thread &worker : threads) {
+        worker.join();
+    }
+    vector<FileAnalysis> analyzed;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (ok[i]) {
+            analyzed.push_back(results[i]);
+        } else {
+            cout << "Cannot read " << files[i] << endl;
+        }
+    }
+    return analyzed;
+}
+
+//
+// *This function prints the predictions of one file, or of a total, as
+// percentages of the analyzed bytes.  Empty files only print their name.
+//
+void printAnalysis(FileAnalysis &analysis) {
+    double base = analysis.analyzed / 100.0;
+    cout << analysis.name << ": " << analysis.analyzed;
+    if (analysis.analyzed < analysis.size) {
+        cout << " of " << analysis.size;
+    }
+    if (analysis.analyzed == 0) {
+        cout << " bytes" << endl;
+        return;
+    }
+    cout << " bytes, entropy " << fixed << setprecision(3) << analysis.entropy
+         << " bits/byte (" << setprecision(1) << analysis.entropy * 12.5
+         << "%)" << endl;
+    cout << "  huf " << analysis.hufSize / base << "%";
+    cout << "  codebook ";
+    if (analysis.codebookSize < 0) {
+        cout << "-";
+    } else {
+        cout << analysis.codebookSize / base << "%";
+    }
+    for (int s = 0; s < N_ANALYZE_BLOCKS; s++) {
+        cout << "  hufb/" << ANALYZE_BLOCK_SIZES[s] / 1024 << "K "
+             << analysis.blockSizes[s] / base << "%";
+    }
+    cout << endl << "  code lengths:";
+    for (int length = 1; length <= MAX_ANALYZE_LENGTH; length++) {
+        if (analysis.lengthSymbols[length] > 0) {
+            cout << " " << length << ":" << analysis.lengthSymbols[length]
+                 << " (" << analysis.lengthBytes[length] / base << "%)";
+        }
+    }
+    cout << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+//
+// *This function analyzes path and prints every file, then the totals and
+// the engine that would give the smallest output overall.
+//
+void analyze(string path, long prefix, int nThreads) {
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    vector<FileAnalysis> files = analyzePath(path, prefix, nThreads);
+    double seconds = secondsSince(t);
+    FileAnalysis total = FileAnalysis();
+    total.name = "total";
+    bool codebookAll = true;
+    for (FileAnalysis &file : files) {
+        printAnalysis(file);
+        total.size += file.size;
+        total.analyzed += file.analyzed;
+        mergeCounts(total.counts, file.counts);
+        total.hufSize += file.hufSize;
+        codebookAll = codebookAll && file.codebookSize >= 0;
+        total.codebookSize += file.codebookSize;
+        for (int s = 0; s < N_ANALYZE_BLOCKS; s++) {
+            total.blockSizes[s] += file.blockSizes[s];
+        }
+    }
+    // entropy and code lengths of the total are of all the bytes together
+    FileAnalysis merged = total;
+    finishAnalysis(merged);
+    total.entropy = merged.entropy;
+    copy(merged.lengthSymbols, merged.lengthSymbols + MAX_ANALYZE_LENGTH + 1,
+         total.lengthSymbols);
+    copy(merged.lengthBytes, merged.lengthBytes + MAX_ANALYZE_LENGTH + 1,
+         total.lengthBytes);
+    if (!codebookAll) {
+        total.codebookSize = -1;
+    }
+    cout << endl;
+    printAnalysis(total);
+
+    string best = "huf";
+    long bestSize = total.hufSize;
+    if (total.codebookSize >= 0 && total.codebookSize < bestSize) {
+        best = "codebook";
+        bestSize = total.codebookSize;
+    }
+    for (int s = 0; s < N_ANALYZE_BLOCKS; s++) {
+        if (total.blockSizes[s] < bestSize) {
+            best = "hufb/" + to_string(ANALYZE_BLOCK_SIZES[s] / 1024) + "K";
+            bestSize = total.blockSizes[s];
+        }
+    }
+    cout << "Smallest: " << best << ", " << bestSize << " bytes" << endl;
+    cout << files.size() << " files analyzed in " << seconds << "s, "
+         << total.analyzed / max(seconds, 1e-9) / 1e6 << " MB/s" << endl;
+}
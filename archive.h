@@ -0,0 +1,464 @@
+// File Name : archive.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : packs many files into one compressed archive (.hufa) with
+//               a central directory so one member can be extracted by
+//               seeking to it
+// Data : 04/12/2022
+//
+// File layout (all integers little endian):
+//   header    : "HUFA", u8 version, u8 flags, u16 reserved
+//               [257 x u32 shared table counts, if ARCHIVE_SHARED_TABLE]
+//   members   : each member is a run of block records as in blockfile.h
+//   directory : per member u16 name length, name, u64 offset,
+//               u64 compressed size, u64 size, u32 CRC-32 of the contents
+//   trailer   : u64 directory offset, u32 number of members, "AIDX"
+// Small members may refer to the shared table as codebook 0.
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "blockfile.h"
+#include "checksum.h"
+
+const char ARCHIVE_MAGIC[] = "HUFA";
+const char ARCHIVE_INDEX_MAGIC[] = "AIDX";
+const int ARCHIVE_VERSION = 1;
+const int ARCHIVE_HEADER_SIZE = 8;
+const int ARCHIVE_TRAILER_SIZE = 16;
+const int ARCHIVE_SHARED_TABLE = 1;
+const long SHARED_TABLE_MAX_MEMBER = 64 * 1024;
+
+struct ArchiveEntry {
+    string name;
+    uint64_t offset;  // where the member's blocks start
+    uint64_t compressedSize;
+    uint64_t size;
+    uint32_t crc;
+};
+
+struct ArchiveOptions {
+    BlockOptions blocks;
+    int nThreads;  // members compressed at once
+    bool sharedTable;  // train a table shared by the small members
+};
+
+//
+// *This function returns the default archive options.
+//
+ArchiveOptions defaultArchiveOptions() {
+    ArchiveOptions options;
+    options.blocks = defaultBlockOptions();
+    options.nThreads = max(1u, thread::hardware_concurrency());
+    options.sharedTable = true;
+    return options;
+}
+
+//
+// *This function adds every regular file below dir to files, with paths
+// relative to root.  The file skip describes, if any, is left out, so an
+// archive written inside the directory it archives is not archived too.
+//
+void listFiles(string root, string dir, vector<string> &files,
+               const struct stat* skip = nullptr) {
+    DIR* d = opendir((root + "/" + dir).c_str());
+    if (d == nullptr) {
+        throw runtime_error("Cannot open directory " + root + "/" + dir);
+    }
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+        string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        string path = dir.empty() ? name : dir + "/" + name;
+        struct stat info;
+        if (stat((root + "/" + path).c_str(), &info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode)) {
+            listFiles(root, path, files, skip);
+        } else if (S_ISREG(info.st_mode)
+                   && !(skip != nullptr && info.st_dev == skip->st_dev
+                        && info.st_ino == skip->st_ino)) {
+            files.push_back(path);
+        }
+    }
+    closedir(d);
+}
+
+//
+// *This function reads a whole file into a string.
+//
+string readFile(string filename) {
+    int fd = openFile(filename, O_RDONLY);
+    string data;
+    data.resize(lseek(fd, 0, SEEK_END));
+    try {
+        preadAll(fd, &data[0], data.size(), 0);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    return data;
+}
+
+//
+// *This function codes data as a run of block records.  Blocks can refer to
+// shared when that is smaller than their own tree.
+//
+string compressMember(const string &data, BlockOptions &options,
+                      Codebook* shared) {
+    string out;
+    BlockJob job;
+    for (long begin = 0; begin < (long)data.size();
+         begin += options.blockSize) {
+        job.rawLength = min(options.blockSize, (long)data.size() - begin);
+        job.input.assign(data.begin() + begin,
+                         data.begin() + begin + job.rawLength);
+        codeBlock(job, options, shared);
+        out += (char)job.type;
+        putU32(out, job.rawLength);
+        if (job.type == BLOCK_RAW) {
+            putU32(out, job.rawLength);
+            out.append(job.input.data(), job.rawLength);
+        } else {
+            putU32(out, job.output.size());
+            out += job.output;
+        }
+    }
+    return out;
+}
+
+//
+// *This function reverses compressMember.
+//
+string decompressMember(const string &member, Codebook* shared) {
+    string out;
+    BlockJob job;
+    long pos = 0;
+    while (pos + BLOCK_RECORD_SIZE <= (long)member.size()) {
+        job.type = member[pos];
+        job.rawLength = getU32(member.data() + pos + 1);
+        long payloadLength = getU32(member.data() + pos + 5);
+        checkBlockRecord(job.type, job.rawLength, payloadLength);
+        pos += BLOCK_RECORD_SIZE;
+        if (pos + payloadLength > (long)member.size()) {
+            throw runtime_error("Truncated archive member!");
+        }
+        if (job.type == BLOCK_RAW) {
+            out.append(member, pos, job.rawLength);
+        } else {
+            job.input.assign(member.begin() + pos,
+                             member.begin() + pos + payloadLength);
+            decodeBlockJob(job, shared, 1);
+            out += job.output;
+        }
+        pos += payloadLength;
+    }
+    return out;
+}
+
+//
+// *This function trains the table shared by the small members, reading them
+// on nThreads threads.  Returns nullptr if there are no small members.
+//
+Codebook* trainSharedTable(string root, vector<string> &files, int nThreads) {
+    long total[BYTE_VALUES] = {0};
+    bool any = false;
+    mutex totalLock;
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for (int t = 0; t < nThreads; t++) {
+        workers.push_back(thread([&]() {
+            long counts[BYTE_VALUES] = {0};
+            bool found = false;
+            size_t i;
+            while ((i = next++) < files.size()) {
+                struct stat info;
+                string path = root + "/" + files[i];
+                if (stat(path.c_str(), &info) != 0
+                    || info.st_size > SHARED_TABLE_MAX_MEMBER) {
+                    continue;
+                }
+                try {
+                    string data = readFile(path);
+                    countBytes(data.data(), data.size(), counts);
+                    found = true;
+                } catch (...) {
+                    // createArchive reports files it cannot read
+                }
+            }
+            lock_guard<mutex> lock(totalLock);
+            for (int b = 0; b < BYTE_VALUES; b++) {
+                total[b] += counts[b];
+            }
+            any = any || found;
+        }));
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    if (!any) {
+        return nullptr;
+    }
+    Codebook* shared = new Codebook;
+    shared->id = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        // every byte stays codable; counts are capped to fit the header
+        shared->counts[b] = (int)min(max(total[b], 1L), 0x7FFFFFFFL);
+    }
+    shared->counts[PSEUDO_EOF] = 1;
+    buildCodebook(shared);
+    return shared;
+}
+
+//
+// *This function frees a codebook that is not in the registry.
+//
+void freeCodebook(Codebook* book) {
+    if (book != nullptr) {
+        freeTree(book->tree);
+        delete book;
+    }
+}
+
+//
+// *This function writes every file below root into archiveName.  Members are
+// compressed on options.nThreads threads and written in the order they
+// finish; the central directory at the end records where each one is.
+// Returns the size of the archive.
+//
+long createArchive(string archiveName, string root, ArchiveOptions options) {
+    vector<string> files;
+    struct stat output;
+    bool exists = (stat(archiveName.c_str(), &output) == 0);
+    listFiles(root, "", files, exists ? &output : nullptr);
+    int nThreads = max(1, options.nThreads);
+    options.blocks.nStreams = 1;  // the archive header has no stream count
+    Codebook* shared = options.sharedTable
+                       ? trainSharedTable(root, files, nThreads) : nullptr;
+
+    int fd = openFile(archiveName, O_WRONLY | O_CREAT | O_TRUNC);
+    vector<ArchiveEntry> entries(files.size());
+    long offset = 0;
+    mutex writeLock;
+    atomic<size_t> next(0);
+    mutex errorLock;
+    exception_ptr error = nullptr;
+    try {
+        string header(ARCHIVE_MAGIC, 4);
+        header += (char)ARCHIVE_VERSION;
+        header += (char)(shared != nullptr ? ARCHIVE_SHARED_TABLE : 0);
+        putU16(header, 0);
+        if (shared != nullptr) {
+            for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+                putU32(header, shared->counts[i]);
+            }
+        }
+        writeAll(fd, header.data(), header.size());
+        offset = header.size();
+
+        vector<thread> workers;
+        for (int t = 0; t < nThreads; t++) {
+            workers.push_back(thread([&]() {
+                size_t i;
+                while ((i = next++) < files.size()) {
+                    try {
+                        string data = readFile(root + "/" + files[i]);
+                        string member = compressMember(data, options.blocks,
+                                                       shared);
+                        ArchiveEntry &entry = entries[i];
+                        entry.name = files[i];
+                        entry.size = data.size();
+                        entry.compressedSize = member.size();
+                        entry.crc = crc32(0, data.data(), data.size());
+                        lock_guard<mutex> lock(writeLock);
+                        entry.offset = offset;
+                        writeAll(fd, member.data(), member.size());
+                        offset += member.size();
+                    } catch (...) {
+                        lock_guard<mutex> lock(errorLock);
+                        if (error == nullptr) {
+                            error = current_exception();
+                        }
+                        next = files.size();
+                    }
+                }
+            }));
+        }
+        for (thread &worker : workers) {
+            worker.join();
+        }
+        if (error != nullptr) {
+            rethrow_exception(error);
+        }
+
+        string directory;
+        for (ArchiveEntry &entry : entries) {
+            putU16(directory, entry.name.size());
+            directory += entry.name;
+            putU64(directory, entry.offset);
+            putU64(directory, entry.compressedSize);
+            putU64(directory, entry.size);
+            putU32(directory, entry.crc);
+        }
+        putU64(directory, offset);
+        putU32(directory, entries.size());
+        directory.append(ARCHIVE_INDEX_MAGIC, 4);
+        writeAll(fd, directory.data(), directory.size());
+        offset += directory.size();
+    } catch (...) {
+        close(fd);
+        freeCodebook(shared);
+        throw;
+    }
+    close(fd);
+    freeCodebook(shared);
+    return offset;
+}
+
+//
+// *This function reads the central directory and the shared table of an
+// archive.  The caller frees shared with freeCodebook.
+//
+vector<ArchiveEntry> readArchiveDirectory(int fd, Codebook* &shared) {
+    shared = nullptr;
+    char header[ARCHIVE_HEADER_SIZE];
+    preadAll(fd, header, ARCHIVE_HEADER_SIZE, 0);
+    if (memcmp(header, ARCHIVE_MAGIC, 4) != 0) {
+        throw runtime_error("Not an archive!");
+    }
+    long fileSize = lseek(fd, 0, SEEK_END);
+    char trailer[ARCHIVE_TRAILER_SIZE];
+    if (fileSize < ARCHIVE_HEADER_SIZE + ARCHIVE_TRAILER_SIZE) {
+        throw runtime_error("Archive has no directory!");
+    }
+    preadAll(fd, trailer, ARCHIVE_TRAILER_SIZE,
+             fileSize - ARCHIVE_TRAILER_SIZE);
+    if (memcmp(trailer + 12, ARCHIVE_INDEX_MAGIC, 4) != 0) {
+        throw runtime_error("Archive has no directory!");
+    }
+    uint64_t directoryOffset = getU64(trailer);
+    long nEntries = getU32(trailer + 8);
+    uint64_t membersStart = ARCHIVE_HEADER_SIZE;
+    if (header[5] & ARCHIVE_SHARED_TABLE) {
+        membersStart += 4 * CODEBOOK_SYMBOLS;
+    }
+    // every entry takes at least 30 bytes, which also bounds nEntries
+    if (directoryOffset < membersStart
+        || directoryOffset > (uint64_t)(fileSize - ARCHIVE_TRAILER_SIZE)
+        || nEntries * 30 > (long)(fileSize - ARCHIVE_TRAILER_SIZE
+                                  - directoryOffset)) {
+        throw runtime_error("Bad archive directory!");
+    }
+    string directory;
+    directory.resize(fileSize - ARCHIVE_TRAILER_SIZE - directoryOffset);
+    preadAll(fd, &directory[0], directory.size(), directoryOffset);
+
+    vector<ArchiveEntry> entries(nEntries);
+    long pos = 0;
+    for (ArchiveEntry &entry : entries) {
+        if (pos + 2 > (long)directory.size()) {
+            throw runtime_error("Bad archive directory!");
+        }
+        int nameLength = getU16(directory.data() + pos);
+        if (pos + 2 + nameLength + 28 > (long)directory.size()) {
+            throw runtime_error("Bad archive directory!");
+        }
+        entry.name = directory.substr(pos + 2, nameLength);
+        pos += 2 + nameLength;
+        entry.offset = getU64(directory.data() + pos);
+        entry.compressedSize = getU64(directory.data() + pos + 8);
+        entry.size = getU64(directory.data() + pos + 16);
+        entry.crc = getU32(directory.data() + pos + 24);
+        pos += 28;
+        // members lie between the header and the directory
+        if (entry.offset < membersStart || entry.offset > directoryOffset
+            || entry.compressedSize > directoryOffset - entry.offset) {
+            throw runtime_error("Bad archive entry " + entry.name);
+        }
+    }
+
+    if (header[5] & ARCHIVE_SHARED_TABLE) {
+        string table;
+        table.resize(4 * CODEBOOK_SYMBOLS);
+        preadAll(fd, &table[0], table.size(), ARCHIVE_HEADER_SIZE);
+        shared = new Codebook;
+        shared->id = 0;
+        for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+            shared->counts[i] = getU32(table.data() + 4 * i);
+        }
+        buildCodebook(shared);
+    }
+    return entries;
+}
+
+//
+// *This function lists the members of an archive.
+//
+vector<ArchiveEntry> listArchive(string archiveName) {
+    int fd = openFile(archiveName, O_RDONLY);
+    Codebook* shared = nullptr;
+    vector<ArchiveEntry> entries;
+    try {
+        entries = readArchiveDirectory(fd, shared);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+    freeCodebook(shared);
+    return entries;
+}
+
+//
+// *This function extracts one member of an archive into outName without
+// reading any other member, and checks its CRC.  Returns the member's size.
+//
+long extractMember(string archiveName, string memberName, string outName) {
+    int fd = openFile(archiveName, O_RDONLY);
+    Codebook* shared = nullptr;
+    string data;
+    try {
+        vector<ArchiveEntry> entries = readArchiveDirectory(fd, shared);
+        bool found = false;
+        for (ArchiveEntry &entry : entries) {
+            if (entry.name != memberName) {
+                continue;
+            }
+            string member;
+            member.resize(entry.compressedSize);
+            preadAll(fd, &member[0], member.size(), entry.offset);
+            data = decompressMember(member, shared);
+            if (data.size() != entry.size
+                || crc32(0, data.data(), data.size()) != entry.crc) {
+                throw runtime_error("Checksum mismatch in " + memberName);
+            }
+            found = true;
+            break;
+        }
+        if (!found) {
+            throw runtime_error(memberName + " is not in the archive");
+        }
+    } catch (...) {
+        close(fd);
+        freeCodebook(shared);
+        throw;
+    }
+    close(fd);
+    freeCodebook(shared);
+
+    int outFd = openFile(outName, O_WRONLY | O_CREAT | O_TRUNC);
+    writeAll(outFd, data.data(), data.size());
+    close(outFd);
+    return data.size();
+}
@@ -0,0 +1,693 @@
+// File Name : benchmark.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : micro benchmarks for the pieces under the compressors,
+//               run from the menu and printed as a table
+// Data : 04/12/2022
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/mman.h>
+#include "blockfile.h"
+#include "btreemap.h"
+#include "daemon.h"
+#include "fdbuf.h"
+#include "hashmap.h"
+#include "jobpool.h"
+#include "mymap.h"
+#include "pipeline.h"
+#include "snapshotmap.h"
+#include "swissmap.h"
+
+using namespace std;
+
+const long BENCH_CHUNK = 64 * 1024;
+const long BENCH_REQUEST = 64 * 1024;  // bytes per request in benchJobs
+const long BENCH_MIN_KEYS = 1000;
+const long BENCH_LOOKUPS = 200000;  // per reader thread in benchSnapshot
+const long BENCH_HASHMAP_KEYS = 10000;  // hashmap has 10 buckets and no growth
+
+//
+// *This function prints one benchmark result as MB/s.
+//
+void printRate(string name, long bytes, double seconds) {
+    cout << left << setw(36) << name << right << setw(10) << fixed
+         << setprecision(1) << bytes / seconds / 1e6 << " MB/s" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+//
+// *This function reads all of in in BENCH_CHUNK pieces and returns the number
+// of bytes read.
+//
+long drain(streambuf &in) {
+    vector<char> chunk(BENCH_CHUNK);
+    long total = 0;
+    streamsize got;
+    while ((got = in.sgetn(chunk.data(), chunk.size())) > 0) {
+        total += got;
+    }
+    return total;
+}
+
+//
+// *This function reads all of in one byte at a time, the way the bitstreams
+// do, asking for the position after every byte.
+//
+long drainBytes(streambuf &in) {
+    long total = 0;
+    while (in.sbumpc() != EOF) {
+        in.pubseekoff(0, ios::cur, ios::in);
+        total++;
+    }
+    return total;
+}
+
+//
+// *This function writes size bytes to out in BENCH_CHUNK pieces.
+//
+void fill(streambuf &out, long size) {
+    vector<char> chunk(BENCH_CHUNK, 'x');
+    for (long done = 0; done < size; done += chunk.size()) {
+        out.sputn(chunk.data(), min((long)chunk.size(), size - done));
+    }
+}
+
+//
+// *This function times reading filename and writing a file of the same size
+// through std::filebuf and through fdbuf with several buffer sizes, with and
+// without O_DIRECT.  Only I/O is timed; nothing is coded.  Reads after the
+// first come from the page cache unless O_DIRECT is on.
+//
+void benchIo(string filename) {
+    struct Config {
+        string name;
+        long bufferSize;
+        bool direct;
+    };
+    Config configs[] = {
+        {"fdbuf 64 KB", 64 * 1024, false},
+        {"fdbuf 1 MB", 1024 * 1024, false},
+        {"fdbuf 8 MB", 8 * 1024 * 1024, false},
+        {"fdbuf 1 MB O_DIRECT", 1024 * 1024, true},
+        {"fdbuf 8 MB O_DIRECT", 8 * 1024 * 1024, true},
+    };
+    string outName = filename + ".iobench";
+    FileOptions saved = fileDefaults();
+
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    filebuf stdIn;
+    stdIn.open(filename, ios::in | ios::binary);
+    long size = drain(stdIn);
+    printRate("read std::filebuf", size, secondsSince(t));
+    t = chrono::steady_clock::now();
+    filebuf stdOut;
+    stdOut.open(outName, ios::out | ios::binary);
+    fill(stdOut, size);
+    stdOut.close();
+    printRate("write std::filebuf", size, secondsSince(t));
+    t = chrono::steady_clock::now();
+    filebuf stdBytes;
+    stdBytes.open(filename, ios::in | ios::binary);
+    drainBytes(stdBytes);
+    printRate("read std::filebuf bytes + tell", size, secondsSince(t));
+
+    for (Config &config : configs) {
+        fileDefaults().bufferSize = config.bufferSize;
+        fileDefaults().direct = config.direct;
+        fileDefaults().preallocate = 0;
+        t = chrono::steady_clock::now();
+        fdbuf in;
+        in.open(filename.c_str(), ios::in);
+        string note = (config.direct && !in.usingDirect())
+                      ? " (no O_DIRECT)" : "";
+        drain(in);
+        printRate("read " + config.name + note, size, secondsSince(t));
+        if (!config.direct) {
+            t = chrono::steady_clock::now();
+            fdbuf bytes;
+            bytes.open(filename.c_str(), ios::in);
+            drainBytes(bytes);
+            printRate("read " + config.name + " bytes + tell", size,
+                      secondsSince(t));
+        }
+        for (int prealloc = 0; prealloc < 2; prealloc++) {
+            fileDefaults().preallocate = prealloc ? size : 0;
+            t = chrono::steady_clock::now();
+            fdbuf out;
+            out.open(outName.c_str(), ios::out);
+            fill(out, size);
+            out.close();
+            printRate("write " + config.name + (prealloc ? " fallocate" : ""),
+                      size, secondsSince(t));
+        }
+    }
+    fileDefaults() = saved;
+    remove(outName.c_str());
+}
+
+//
+// *This function returns the contents of filename.
+//
+string loadFile(string filename) {
+    ifstream input(filename, ios::binary);
+    return string((istreambuf_iterator<char>(input)),
+                  istreambuf_iterator<char>());
+}
+
+//
+// *This function times coding filename with its own code table one byte per
+// lookup and two bytes per lookup, plus the cost of building the pair
+// table, and checks that both give the same bits.
+//
+void benchEncode(string filename) {
+    string data = loadFile(filename);
+    long counts[BYTE_VALUES] = {0};
+    countBytes(data.data(), data.size(), counts);
+    hashmap frequencyMap;
+    histogramFrequencyMap(counts, false, frequencyMap);
+    HuffmanNode* tree = buildEncodingTree(frequencyMap);
+    CodeEntry table[PSEUDO_EOF + 1];
+    buildCodeTable(tree, table);
+    freeTree(tree);
+
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    vector<PairEntry> pairs;
+    buildPairTable(table, pairs);
+    double buildSeconds = secondsSince(t);
+    long fallbacks = 0;
+    for (int first = 0; first < BYTE_VALUES; first++) {
+        for (int second = 0; second < BYTE_VALUES; second++) {
+            if (counts[first] > 0 && counts[second] > 0
+                && pairs[first | (second << 8)].length < 0) {
+                fallbacks++;
+            }
+        }
+    }
+
+    t = chrono::steady_clock::now();
+    bitwriter single;
+    encodeSymbols(data.data(), data.size(), table, nullptr, single);
+    printRate("encode 1 byte per lookup", data.size(), secondsSince(t));
+    t = chrono::steady_clock::now();
+    bitwriter paired;
+    encodeSymbols(data.data(), data.size(), table, pairs.data(), paired);
+    printRate("encode 2 bytes per lookup", data.size(), secondsSince(t));
+    cout << "Pair table built in " << buildSeconds * 1e3 << "ms, "
+         << fallbacks << " used pairs too long for one step" << endl;
+    cout << (single.bytes() == paired.bytes() ? "Outputs match"
+             : "OUTPUTS DIFFER") << endl;
+}
+
+//
+// *This function times counting filename with the one table loop, the four
+// table loop and parallelHistogram on 1 to 8 threads.  The file is loaded
+// first so only counting is timed.
+//
+void benchHistogram(string filename) {
+    string data = loadFile(filename);
+    long reference[BYTE_VALUES] = {0};
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    countBytes(data.data(), data.size(), reference);
+    printRate("count 1 table", data.size(), secondsSince(t));
+
+    long counts[BYTE_VALUES] = {0};
+    t = chrono::steady_clock::now();
+    countBytesUnrolled(data.data(), data.size(), counts);
+    printRate("count 4 tables", data.size(), secondsSince(t));
+
+    bool same = equal(counts, counts + BYTE_VALUES, reference);
+    for (int nThreads = 1; nThreads <= 8; nThreads *= 2) {
+        long parallel[BYTE_VALUES] = {0};
+        long first[BYTE_VALUES];
+        t = chrono::steady_clock::now();
+        parallelHistogram(data.data(), data.size(), nThreads, parallel, first);
+        printRate("parallel " + to_string(nThreads) + " threads", data.size(),
+                  secondsSince(t));
+        same = same && equal(parallel, parallel + BYTE_VALUES, reference);
+    }
+    cout << (same ? "Counts match" : "COUNTS DIFFER") << " ("
+         << thread::hardware_concurrency() << " cores)" << endl;
+}
+
+//
+// *This function splits filename into BENCH_REQUEST sized requests and
+// times compressing them one after another, on a new thread per request,
+// and through the shared worker pool.  The pool results are decompressed
+// through the pool and checked, then half of a second batch is cancelled.
+//
+void benchJobs(string filename) {
+    string data = loadFile(filename);
+    vector<string> requests;
+    for (long begin = 0; begin < (long)data.size(); begin += BENCH_REQUEST) {
+        requests.push_back(data.substr(begin, BENCH_REQUEST));
+    }
+    BlockOptions options = defaultBlockOptions();
+    options.queueDepth = 0;
+
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    BlockJob scratch;
+    for (string &request : requests) {
+        compressBuffer(request, options, scratch, nullptr);
+    }
+    printRate("one thread", data.size(), secondsSince(t));
+
+    t = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (string &request : requests) {
+        threads.push_back(thread([&options, &request]() {
+            BlockOptions local = options;
+            BlockJob job;
+            compressBuffer(request, local, job, nullptr);
+        }));
+    }
+    for (thread &worker : threads) {
+        worker.join();
+    }
+    printRate("thread per request", data.size(), secondsSince(t));
+
+    workerpool &pool = workerpool::shared();
+    t = chrono::steady_clock::now();
+    vector<jobhandle> handles;
+    for (string &request : requests) {
+        handles.push_back(compressAsync(request));
+    }
+    vector<string> images;
+    for (jobhandle &handle : handles) {
+        images.push_back(handle.get());
+    }
+    printRate("pool of " + to_string(pool.size()) + " workers", data.size(),
+              secondsSince(t));
+
+    handles.clear();
+    for (string &image : images) {
+        handles.push_back(decompressAsync(image, PRIORITY_HIGH));
+    }
+    bool same = true;
+    for (size_t i = 0; i < handles.size(); i++) {
+        same = same && (handles[i].get() == requests[i]);
+    }
+    cout << (same ? "Round trips match" : "ROUND TRIPS DIFFER") << endl;
+
+    handles.clear();
+    atomic<long> called(0);
+    for (string &request : requests) {
+        handles.push_back(compressAsync(request, PRIORITY_LOW,
+            [&called](const string &, exception_ptr) { called++; }));
+    }
+    long cancelled = 0;
+    for (size_t i = 0; i < handles.size(); i += 2) {
+        handles[i].cancel();
+    }
+    for (jobhandle &handle : handles) {
+        try {
+            handle.get();
+        } catch (runtime_error &) {
+            cancelled++;
+        }
+    }
+    cout << cancelled << " of " << handles.size() << " jobs cancelled, "
+         << called << " callbacks" << endl;
+}
+
+//
+// *This function returns a memfd holding data, for passing buffers to the
+// daemon without a file on disk.
+//
+int memoryFile(const string &data) {
+    int fd = memfd_create("huffman", MFD_CLOEXEC);
+    if (fd < 0) {
+        throw runtime_error("memfd_create failed!");
+    }
+    writeAll(fd, data.data(), data.size());
+    return fd;
+}
+
+//
+// *This function is a load generator for the daemon at path.  nClients
+// threads each send nRequests compress requests for BENCH_REQUEST sized
+// pieces of filename, passed as memfds, and decompress every result through
+// the daemon again to check it.  Prints throughput and request latencies.
+//
+void benchDaemon(string path, string filename, int nClients, int nRequests) {
+    string data = loadFile(filename);
+    vector<string> pieces;
+    for (long begin = 0; begin < (long)data.size(); begin += BENCH_REQUEST) {
+        pieces.push_back(data.substr(begin, BENCH_REQUEST));
+    }
+    if (pieces.empty()) {
+        pieces.push_back("");
+    }
+    vector<vector<double> > latencies(nClients);
+    atomic<long> bytes(0);
+    atomic<long> errors(0);
+    atomic<long> mismatches(0);
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    vector<thread> clients;
+    for (int c = 0; c < nClients; c++) {
+        clients.push_back(thread([&, c]() {
+            for (int r = 0; r < nRequests; r++) {
+                const string &piece =
+                    pieces[(c * nRequests + r) % pieces.size()];
+                chrono::steady_clock::time_point start =
+                    chrono::steady_clock::now();
+                int in = -1;
+                int packed = -1;
+                int back = -1;
+                try {
+                    in = memoryFile(piece);
+                    packed = memoryFile("");
+                    back = memoryFile("");
+                    string text;
+                    daemonRequest(path, DAEMON_COMPRESS, in, packed,
+                                  PRIORITY_NORMAL, text);
+                    latencies[c].push_back(secondsSince(start));
+                    daemonRequest(path, DAEMON_DECOMPRESS, packed, back,
+                                  PRIORITY_NORMAL, text);
+                    if (readDescriptor(back) != piece) {
+                        mismatches++;
+                    }
+                    bytes += piece.size();
+                } catch (runtime_error &) {
+                    errors++;
+                }
+                for (int fd : {in, packed, back}) {
+                    if (fd >= 0) {
+                        close(fd);
+                    }
+                }
+            }
+        }));
+    }
+    for (thread &client : clients) {
+        client.join();
+    }
+    double seconds = secondsSince(t);
+    vector<double> all;
+    for (vector<double> &client : latencies) {
+        all.insert(all.end(), client.begin(), client.end());
+    }
+    sort(all.begin(), all.end());
+    long requests = (long)nClients * nRequests;
+    cout << requests << " compress + " << requests << " decompress requests in "
+         << seconds << "s, " << 2 * requests / seconds << " requests/s" << endl;
+    printRate("compressed and checked", bytes, seconds);
+    if (!all.empty()) {
+        cout << "compress latency p50 " << all[all.size() / 2] * 1e3
+             << "ms, p99 " << all[all.size() * 99 / 100] * 1e3 << "ms" << endl;
+    }
+    cout << errors << " errors, " << mismatches << " mismatches" << endl;
+}
+
+//
+// std::map with the put and get of mymap, so benchMaps can time all three
+// maps with one template.
+//
+struct stdmap : public map<int, int> {
+    void put(int key, int value) {
+        (*this)[key] = value;
+    }
+    int get(int key) {
+        map<int, int>::iterator it = find(key);
+        return (it == end()) ? 0 : it->second;
+    }
+};
+
+//
+// *These functions return the key an in order walk of a map visits.
+//
+long walkedKey(int key) {
+    return key;
+}
+long walkedKey(const pair<const int, int> &entry) {
+    return entry.first;
+}
+
+//
+// *This function fills a Map with keys, looks up every key of lookups and
+// walks it in order, printing the nanoseconds per key of each step.
+// Returns a checksum of the values and keys seen so the work is not
+// optimized away.
+//
+template<typename Map>
+long benchMap(string name, const vector<int> &keys,
+              const vector<int> &lookups) {
+    Map map;
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    for (int key : keys) {
+        map.put(key, key ^ 1);
+    }
+    double putSeconds = secondsSince(t);
+
+    long sum = 0;
+    t = chrono::steady_clock::now();
+    for (int key : lookups) {
+        sum += map.get(key);
+    }
+    double getSeconds = secondsSince(t);
+
+    t = chrono::steady_clock::now();
+    for (auto entry : map) {
+        sum += walkedKey(entry);
+    }
+    double walkSeconds = secondsSince(t);
+
+    double scale = 1e9 / keys.size();
+    cout << left << setw(12) << keys.size() << setw(12) << name << right
+         << fixed << setprecision(1) << setw(10) << putSeconds * scale
+         << setw(10) << getSeconds * scale << setw(10) << walkSeconds * scale
+         << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    return sum;
+}
+
+//
+// *This function times mymap, btreemap and std::map with BENCH_MIN_KEYS
+// distinct int keys and every tenfold up to maxKeys.  Keys are put in
+// random order and looked up in another random order.
+//
+void benchMaps(long maxKeys) {
+    cout << left << setw(12) << "keys" << setw(12) << "map" << right
+         << setw(10) << "put ns" << setw(10) << "get ns" << setw(10)
+         << "walk ns" << endl;
+    mt19937 random(251);
+    for (long n = BENCH_MIN_KEYS; n <= maxKeys; n *= 10) {
+        vector<int> keys(n);
+        for (long i = 0; i < n; i++) {
+            keys[i] = (int)(i * 2);  // gaps so some lookups could miss
+        }
+        shuffle(keys.begin(), keys.end(), random);
+        vector<int> lookups = keys;
+        shuffle(lookups.begin(), lookups.end(), random);
+
+        long sums[3];
+        sums[0] = benchMap<mymap<int, int> >("mymap", keys, lookups);
+        sums[1] = benchMap<btreemap<int, int> >("btreemap", keys, lookups);
+        sums[2] = benchMap<stdmap>("std::map", keys, lookups);
+        if (sums[0] != sums[2] || sums[1] != sums[2]) {
+            cout << "RESULTS DIFFER" << endl;
+        }
+    }
+}
+
+//
+// *This function runs nThreads threads that each call lookup on
+// BENCH_LOOKUPS keys below nKeys and prints the lookups per second of all
+// of them together.
+//
+template<typename Lookup>
+void timeReaders(string name, int nThreads, int nKeys, Lookup lookup) {
+    atomic<long> sum(0);
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.push_back(thread([&sum, &lookup, i, nKeys]() {
+            long local = 0;
+            for (long k = 0; k < BENCH_LOOKUPS; k++) {
+                local += lookup((int)((k * 7919 + i) % nKeys));
+            }
+            sum += local;
+        }));
+    }
+    for (thread &worker : threads) {
+        worker.join();
+    }
+    double seconds = secondsSince(t);
+    cout << left << setw(36) << name << right << setw(10) << fixed
+         << setprecision(1) << nThreads * BENCH_LOOKUPS / seconds / 1e6
+         << " M lookups/s" << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+}
+
+//
+// *This function times nThreads threads looking up keys in a map of nKeys
+// ints shared three ways: a mymap behind a mutex, a snapshotmap, and a
+// snapshotmap that another thread keeps publishing new snapshots of.
+//
+void benchSnapshot(int nKeys, int nThreads) {
+    nKeys = max(1, nKeys);
+    mymap<int, int> locked;
+    mutex lock;
+    snapshotmap<int, int> shared;
+    vector<pair<int, int> > pairs;
+    for (int key = 0; key < nKeys; key++) {
+        locked.put(key, key);
+        pairs.push_back(make_pair(key, key));
+    }
+    shared.putAll(pairs);
+
+    timeReaders("mymap with mutex", nThreads, nKeys, [&](int key) {
+        lock_guard<mutex> guard(lock);
+        return locked.get(key);
+    });
+    timeReaders("snapshotmap", nThreads, nKeys, [&](int key) {
+        return shared.get(key);
+    });
+
+    atomic<bool> done(false);
+    long published = 0;
+    thread writer([&]() {
+        while (!done) {
+            shared.put(published % nKeys, published);
+            published++;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    });
+    timeReaders("snapshotmap while writing", nThreads, nKeys, [&](int key) {
+        return shared.get(key);
+    });
+    done = true;
+    writer.join();
+    cout << published << " snapshots published, " << shared.reclaimedCount()
+         << " old ones freed" << endl;
+}
+
+//
+// std::unordered_map with the put, get, containsKey and remove of
+// swissmap, so benchHashMaps can time the hash maps with one template.
+//
+struct stdhashmap : public unordered_map<int, long> {
+    void put(int key, long value) {
+        (*this)[key] = value;
+    }
+    long get(int key) const {
+        unordered_map<int, long>::const_iterator it = find(key);
+        return (it == end()) ? 0 : it->second;
+    }
+    bool containsKey(int key) const {
+        return count(key) > 0;
+    }
+    bool remove(int key) {
+        return erase(key) > 0;
+    }
+};
+
+//
+// *These functions remove every key from a map and return the seconds it
+// took, or -1 for hashmap, which cannot remove keys.
+//
+template<typename Map>
+double timeRemove(Map &map, const vector<int> &keys) {
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    for (int key : keys) {
+        map.remove(key);
+    }
+    return secondsSince(t);
+}
+double timeRemove(hashmap &, const vector<int> &) {
+    return -1;
+}
+
+//
+// *This function times putting keys into a Map, getting every key, looking
+// up misses and removing every key, and prints nanoseconds per operation.
+// Returns a checksum of the values found.
+//
+template<typename Map>
+long benchHashMap(string name, const vector<int> &keys,
+                  const vector<int> &lookups, const vector<int> &misses) {
+    Map map;
+    chrono::steady_clock::time_point t = chrono::steady_clock::now();
+    for (int key : keys) {
+        map.put(key, key);
+    }
+    double putSeconds = secondsSince(t);
+
+    long sum = 0;
+    t = chrono::steady_clock::now();
+    for (int key : lookups) {
+        sum += map.get(key);
+    }
+    double getSeconds = secondsSince(t);
+
+    t = chrono::steady_clock::now();
+    for (int key : misses) {
+        sum += map.containsKey(key);
+    }
+    double missSeconds = secondsSince(t);
+    double removeSeconds = timeRemove(map, lookups);
+
+    double scale = 1e9 / keys.size();
+    cout << left << setw(12) << keys.size() << setw(16) << name << right
+         << fixed << setprecision(1) << setw(10) << putSeconds * scale
+         << setw(10) << getSeconds * scale << setw(10) << missSeconds * scale;
+    if (removeSeconds < 0) {
+        cout << setw(10) << "-";
+    } else {
+        cout << setw(10) << removeSeconds * scale;
+    }
+    cout << endl;
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+    return sum;
+}
+
+//
+// *This function times hashmap, std::unordered_map and swissmap with
+// BENCH_MIN_KEYS random int keys and every tenfold up to maxKeys.  Lookups
+// of present keys come in another random order; misses are keys that were
+// never put.  hashmap is only timed up to BENCH_HASHMAP_KEYS.
+//
+void benchHashMaps(long maxKeys) {
+    cout << left << setw(12) << "keys" << setw(16) << "map" << right
+         << setw(10) << "put ns" << setw(10) << "get ns" << setw(10)
+         << "miss ns" << setw(10) << "remove ns" << endl;
+    mt19937 random(251);
+    for (long n = BENCH_MIN_KEYS; n <= maxKeys; n *= 10) {
+        vector<int> keys(n);
+        vector<int> misses(n);
+        for (long i = 0; i < n; i++) {
+            keys[i] = (int)(random() & 0x7FFFFFFE);  // even keys are put
+            misses[i] = keys[i] | 1;
+        }
+        vector<int> lookups = keys;
+        shuffle(lookups.begin(), lookups.end(), random);
+
+        long swiss = benchHashMap<swissmap<int, long> >("swissmap", keys,
+                                                       lookups, misses);
+        long unordered = benchHashMap<stdhashmap>("unordered_map", keys,
+                                                  lookups, misses);
+        bool same = (swiss == unordered);
+        if (n <= BENCH_HASHMAP_KEYS) {
+            same = same && (benchHashMap<hashmap>("hashmap", keys, lookups,
+                                                  misses) == swiss);
+        }
+        if (!same) {
+            cout << "RESULTS DIFFER" << endl;
+        }
+    }
+}
@@ -0,0 +1,187 @@
+// File Name : bitbuffer.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : bit writer and reader over in-memory byte buffers.  Bits
+//               are packed in the same order as ofbitstream (first bit in
+//               the lowest bit of each byte).
+// Data : 04/12/2022
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+
+using namespace std;
+
+class bitwriter {
+ public:
+    bitwriter() {
+        acc = 0;
+        nAcc = 0;
+    }
+
+    //
+    // writeBits:
+    // Appends the low length bits of bits, lowest bit first.
+    //
+    void writeBits(uint64_t bits, int length) {
+        if (length > 32) {
+            writeBits(bits & 0xFFFFFFFF, 32);
+            writeBits(bits >> 32, length - 32);
+            return;
+        }
+        acc |= bits << nAcc;
+        nAcc += length;
+        while (nAcc >= 8) {
+            out += (char)(acc & 0xFF);
+            acc >>= 8;
+            nAcc -= 8;
+        }
+    }
+
+    //
+    // bitCount:
+    // Returns the number of bits written so far.
+    //
+    long bitCount() {
+        return 8 * (long)out.size() + nAcc;
+    }
+
+    //
+    // bytes:
+    // Flushes the last partial byte (zero padded) and returns the buffer.
+    //
+    string& bytes() {
+        if (nAcc > 0) {
+            out += (char)(acc & 0xFF);
+            acc = 0;
+            nAcc = 0;
+        }
+        return out;
+    }
+
+ private:
+    string out;
+    uint64_t acc;  // bits not yet written to out
+    int nAcc;  // number of bits in acc
+};
+
+//
+// *This function returns the 8 bytes at p as a little endian number.
+//
+uint64_t loadLE64(const unsigned char* p) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+//
+// bitreader:
+// Reads bits written by bitwriter or ofbitstream from a byte buffer.  Up to
+// 63 upcoming bits are kept in a 64-bit container that is refilled with one
+// unaligned 8 byte load, so peekBits, consume and readBits never touch the
+// buffer bit by bit.  Reading past the end returns zero bits; readBit and
+// bitsLeft tell callers where the real data stops.
+//
+class bitreader {
+ public:
+    static const int MAX_PEEK = 56;  // most bits peekBits can return
+
+    bitreader(const char* data, long length, long firstBit = 0) {
+        this->end = (const unsigned char*)data + length;
+        this->p = (const unsigned char*)data + min(firstBit / 8, length);
+        this->nBits = length * 8;
+        this->pos = firstBit;
+        buffer = 0;
+        count = 0;
+        _refill();
+        buffer >>= firstBit % 8;
+        count -= firstBit % 8;
+    }
+
+    //
+    // peekBits:
+    // Returns the next n bits (n <= MAX_PEEK), first bit lowest, without
+    // consuming them.
+    //
+    uint64_t peekBits(int n) {
+        if (count < n) {
+            _refill();
+        }
+        return buffer & ((1ULL << n) - 1);
+    }
+
+    //
+    // consume:
+    // Skips n bits that were already peeked.
+    //
+    void consume(int n) {
+        buffer >>= n;
+        count -= n;
+        pos += n;
+    }
+
+    //
+    // readBits:
+    // Returns and consumes the next n bits (n <= MAX_PEEK).
+    //
+    uint64_t readBits(int n) {
+        uint64_t bits = peekBits(n);
+        consume(n);
+        return bits;
+    }
+
+    //
+    // readBit:
+    // Returns the next bit, or EOF when the buffer is exhausted.
+    //
+    int readBit() {
+        if (pos >= nBits) {
+            return EOF;
+        }
+        return (int)readBits(1);
+    }
+
+    //
+    // bitsLeft:
+    // Returns the number of bits not yet consumed.
+    //
+    long bitsLeft() {
+        return nBits - pos;
+    }
+
+ private:
+    const unsigned char* p;  // next byte to load
+    const unsigned char* end;
+    long nBits;
+    long pos;  // index of the next bit to read
+    uint64_t buffer;  // upcoming bits, next one lowest
+    int count;  // valid bits in buffer
+
+    //
+    // _refill
+    //
+    // tops buffer up to at least 56 bits: 8 bytes at once while they are
+    // there, then a byte at a time with zeros past the end
+    void _refill() {
+        if (end - p >= 8) {
+            buffer |= loadLE64(p) << count;
+            p += (63 - count) >> 3;
+            count |= 56;
+            return;
+        }
+        while (count < 56) {
+            if (p < end) {
+                buffer |= (uint64_t)*p++ << count;
+            }
+            count += 8;
+        }
+    }
+};
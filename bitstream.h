@@ -33,6 +33,7 @@
 #include <ostream>
 #include <fstream>
 #include <sstream>
+#include "fdbuf.h"
 
 /**
  * Constant: PSEUDO_EOF
@@ -412,8 +413,8 @@ public:
     }
     
 private:
-    // the actual file buffer which does reading and writing.
-    std::filebuf fb;
+    // the actual file buffer which does reading and writing (see fdbuf.h)
+    fdbuf fb;
 };
 
 /**
@@ -506,6 +507,16 @@ public:
     }
 
     
+    /* Member function ofbitstream::reserve
+     * ------------------------------------
+     * Allocates the given number of bytes for the file up front, when its
+     * exact size is known before writing.  The file is trimmed to what was
+     * written when it is closed.  Returns false if allocation failed.
+     */
+    bool reserve(long bytes) {
+        return fb.reserve(bytes);
+    }
+
     /* Member function ofbitstream::is_open
      * ------------------------------------
      * Determines whether the file stream is open.
@@ -533,8 +544,8 @@ public:
      */
     
 private:
-    // the actual file buffer which does reading and writing.
-    std::filebuf fb;
+    // the actual file buffer which does reading and writing (see fdbuf.h)
+    fdbuf fb;
 };
 
 /**
@@ -0,0 +1,1161 @@
+// File Name : blockfile.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : block compressed files (.hufb).  Each block gets its own
+//               tree, and blocks that would not shrink are stored raw.
+// Data : 04/12/2022
+//
+// File layout (all integers little endian):
+//   header : "HUFB", u8 version, u8 flags, u16 streams, u32 block size
+//   block  : u8 type, u32 raw length, u32 payload length, payload
+//   index  : per block u64 raw offset, u64 record offset, u32 nPoints,
+//            nPoints x u32 bit offset of a seek point in the coded bits
+//   trailer: u64 index offset, u32 number of blocks, u32 seek interval,
+//            "BIDX"
+// The index and trailer are only there if the BLOCKFILE_INDEXED flag is
+// set.  Appending adds blocks, an index and a trailer after the old
+// trailer, so only the last index is live and blocks are found through
+// it.  If an append was cut short the file does not end in a trailer, and
+// readers use the last complete one before the end.  Seek point k of a
+// coded block is where byte k * seek interval of the block starts (byte
+// k * span with streams, see below), so a reader can decode from there.
+// Payload by block type:
+//   BLOCK_HUFFMAN : u16 nSymbols, nSymbols x (u8 byte, u32 count), bits
+//   BLOCK_RAW     : the block bytes as they are
+//   BLOCK_CODEBOOK: u8 codebook id, u32 hash of its counts (see
+//                   codebookHash), bits coded with that shared codebook
+// The PSEUDO_EOF symbol is never coded in a block (the raw length says
+// where it ends) but keeps its count of one in every block's tree.
+// If the BLOCKFILE_STREAMS flag is set, the bits of every coded block are
+// split into the header's number of streams:
+//   u32 segment length, (streams - 1) x u32 end of stream s, streams
+// Stream s codes bytes [s * segment length, (s + 1) * segment length) of
+// the block and starts on a byte boundary.  Seek points count from the
+// start of stream 0.  A segment is a whole number of the block's seek
+// spans: the seek interval, or for blocks too small to give every stream
+// a full interval, the segment length divided by the number of intervals
+// it would need (see streamSpanLength), so seek point k is where byte
+// k * span starts.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "util.h"
+#include "histogram.h"
+#include "codebook.h"
+#include "codebookcache.h"
+#include "bitbuffer.h"
+#include "decodekernel.h"
+#include "pipeline.h"
+#include "uring.h"
+
+const char BLOCKFILE_MAGIC[] = "HUFB";
+const int BLOCKFILE_VERSION = 2;  // 2 added the codebook hash
+const int BLOCKFILE_HEADER_SIZE = 12;
+const int BLOCK_RECORD_SIZE = 9;
+const long DEFAULT_BLOCK_SIZE = 1024 * 1024;
+const long DEFAULT_SEEK_INTERVAL = 64 * 1024;
+// Seek points are u32 bit offsets, and a coded block is always smaller than
+// its raw bytes, so blocks up to 2^32 bits fit.
+const long MAX_BLOCK_SIZE = 512L * 1024 * 1024;
+const int BLOCKFILE_INDEXED = 1;
+const int BLOCKFILE_STREAMS = 2;
+const char BLOCKFILE_INDEX_MAGIC[] = "BIDX";
+const int BLOCKFILE_TRAILER_SIZE = 20;
+
+const int PAIR_TABLE_SIZE = 256 * 256;
+const long PAIR_TABLE_MIN_BLOCK = 256 * 1024;
+const int PAIR_CODE_BUDGET = 32;  // bits bitwriter takes in one step
+
+const int BLOCK_HUFFMAN = 0;
+const int BLOCK_RAW = 1;
+const int BLOCK_CODEBOOK = 2;
+
+//
+// blockchecker:
+// Checks the blocks writeBlocks codes.  check() sees each coded block
+// right after it is coded and may defer the work; finish() is called once
+// every block is written but before the index, so a file whose blocks
+// failed never gets a valid index.  Either one throws if a block failed.
+//
+class blockchecker {
+ public:
+    virtual ~blockchecker() {}
+    virtual void check(const BlockJob &job, int nStreams) = 0;
+    virtual long finish() = 0;
+};
+
+struct BlockOptions {
+    long blockSize;  // uncompressed bytes per block
+    int sampleSlices;  // 0 builds each block's tree from a full scan
+    int queueDepth;  // blocks queued between pipeline stages, 0 for serial
+    int uringDepth;  // io_uring reads in flight per block, 0 for pread
+    long seekInterval;  // uncompressed bytes between seek points
+    int nStreams;  // interleaved streams per coded block: 1, 4 or 8
+    codebookcache* cache;  // codebooks to reuse across files, or nullptr
+    blockchecker* verify;  // checks coded blocks, or nullptr
+};
+
+//
+// One entry of the seek table.
+//
+struct SeekBlock {
+    long rawOffset;  // offset of the block in the uncompressed data
+    long recordOffset;  // offset of the block record in the file
+    vector<uint32_t> seekBits;
+};
+
+//
+// *This function returns the default block options.
+//
+BlockOptions defaultBlockOptions() {
+    BlockOptions options;
+    options.blockSize = DEFAULT_BLOCK_SIZE;
+    options.sampleSlices = 0;
+    options.queueDepth = 2;
+    options.uringDepth = 0;
+    options.seekInterval = DEFAULT_SEEK_INTERVAL;
+    options.nStreams = 1;
+    options.cache = nullptr;
+    options.verify = nullptr;
+    return options;
+}
+
+//
+// *These functions append little endian integers to a byte buffer and read
+// them back.
+//
+void putU16(string &out, uint32_t value) {
+    out += (char)(value & 0xFF);
+    out += (char)((value >> 8) & 0xFF);
+}
+
+void putU32(string &out, uint32_t value) {
+    putU16(out, value & 0xFFFF);
+    putU16(out, value >> 16);
+}
+
+void putU64(string &out, uint64_t value) {
+    putU32(out, value & 0xFFFFFFFF);
+    putU32(out, value >> 32);
+}
+
+uint32_t getU16(const char* in) {
+    const unsigned char* p = (const unsigned char*)in;
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t getU32(const char* in) {
+    return getU16(in) | (getU16(in + 2) << 16);
+}
+
+uint64_t getU64(const char* in) {
+    return getU32(in) | ((uint64_t)getU32(in + 4) << 32);
+}
+
+//
+// *This function writes all length bytes of data to fd.
+//
+void writeAll(int fd, const char* data, long length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw runtime_error("Write failed!");
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+//
+// *This function reads exactly length bytes from fd.  Returns false if the
+// file ends before any byte was read, and throws if it ends part way.
+//
+bool readAll(int fd, char* data, long length) {
+    long done = 0;
+    while (done < length) {
+        ssize_t n = read(fd, data + done, length - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw runtime_error("Read failed!");
+        }
+        if (n == 0) {
+            if (done == 0) {
+                return false;
+            }
+            throw runtime_error("Truncated block file!");
+        }
+        done += n;
+    }
+    return true;
+}
+
+//
+// *This function copies length bytes at inOffset in inFd to the current
+// position of outFd.  It uses copy_file_range so the data can stay in the
+// kernel, and falls back to pread/write where that is not supported (e.g.
+// across file systems).  The file position of inFd is not changed.
+//
+void copyRange(int inFd, long inOffset, int outFd, long length) {
+    loff_t offset = inOffset;
+    while (length > 0) {
+        ssize_t n = copy_file_range(inFd, &offset, outFd, nullptr, length, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        length -= n;
+    }
+    vector<char> buffer(min(length, DEFAULT_SLICE_SIZE));
+    while (length > 0) {
+        long want = min(length, (long)buffer.size());
+        preadAll(inFd, buffer.data(), want, offset);
+        writeAll(outFd, buffer.data(), want);
+        offset += want;
+        length -= want;
+    }
+}
+
+//
+// *This function returns the exact size in bytes of a Huffman payload for
+// counts coded with table, including its frequency table.
+//
+long estimateCodedSize(const long counts[], CodeEntry table[]) {
+    long bits = 0;
+    long nSymbols = 0;
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        if (counts[i] > 0) {
+            bits += counts[i] * table[i].length;
+            nSymbols++;
+        }
+    }
+    return 2 + 5 * nSymbols + (bits + 7) / 8;
+}
+
+//
+// Codes of two consecutive bytes, indexed by first byte | second byte << 8.
+//
+struct PairEntry {
+    uint32_t bits;
+    int length;  // -1 if the two codes do not fit in PAIR_CODE_BUDGET bits
+};
+
+//
+// *This function builds the pair table of a code table.
+//
+void buildPairTable(const CodeEntry table[], vector<PairEntry> &pairs) {
+    pairs.resize(PAIR_TABLE_SIZE);
+    for (int first = 0; first < BYTE_VALUES; first++) {
+        for (int second = 0; second < BYTE_VALUES; second++) {
+            PairEntry &pair = pairs[first | (second << 8)];
+            int length = table[first].length + table[second].length;
+            if (length > PAIR_CODE_BUDGET) {
+                pair.length = -1;
+                continue;
+            }
+            pair.bits = table[first].bits
+                        | (table[second].bits << table[first].length);
+            pair.length = length;
+        }
+    }
+}
+
+//
+// *This function writes the codes of length bytes of data to out.  If pairs
+// is not nullptr, two bytes are coded per lookup wherever their codes fit.
+//
+void encodeSymbols(const char* data, long length, const CodeEntry table[],
+                   const PairEntry* pairs, bitwriter &out) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    long i = 0;
+    if (pairs != nullptr) {
+        for (; i + 1 < length; i += 2) {
+            const PairEntry &pair = pairs[bytes[i] | (bytes[i + 1] << 8)];
+            if (pair.length >= 0) {
+                out.writeBits(pair.bits, pair.length);
+            } else {
+                out.writeBits(table[bytes[i]].bits, table[bytes[i]].length);
+                out.writeBits(table[bytes[i + 1]].bits,
+                              table[bytes[i + 1]].length);
+            }
+        }
+    }
+    for (; i < length; i++) {
+        out.writeBits(table[bytes[i]].bits, table[bytes[i]].length);
+    }
+}
+
+//
+// *This function encodes a block with table into out.  The bit offset
+// (from the start of out) of every seekInterval'th byte is added to
+// seekBits.  Blocks of at least PAIR_TABLE_MIN_BLOCK bytes build a pair
+// table first; smaller ones would not earn back its 64K entries.
+//
+void encodeBlock(const char* data, long length, CodeEntry table[],
+                 bitwriter &out, long seekInterval,
+                 vector<uint32_t> &seekBits) {
+    vector<PairEntry> pairs;
+    if (length >= PAIR_TABLE_MIN_BLOCK) {
+        buildPairTable(table, pairs);
+    }
+    const PairEntry* pairTable = pairs.empty() ? nullptr : pairs.data();
+    long start = out.bitCount();
+    for (long begin = 0; begin < length; begin += seekInterval) {
+        seekBits.push_back(out.bitCount() - start);
+        long end = min(length, begin + seekInterval);
+        encodeSymbols(data + begin, end - begin, table, pairTable, out);
+    }
+}
+
+//
+// *This function returns the bytes of a block coded by each of nStreams
+// streams: an equal share rounded up to a whole number of seek spans.
+// Spans shrink below seekInterval so the share needs as few of them as
+// possible, which keeps every stream busy in blocks too small for
+// nStreams full spans.
+//
+long streamSegmentLength(long length, int nStreams, long seekInterval) {
+    long share = (length + nStreams - 1) / nStreams;
+    long nSpans = max(1L, (share + seekInterval - 1) / seekInterval);
+    return (share + nSpans - 1) / nSpans * nSpans;
+}
+
+//
+// *This function returns the seek span of the streams of a block whose
+// segment length is segmentLength, as chosen by streamSegmentLength.
+// Segments that are whole seek intervals give seekInterval.
+//
+long streamSpanLength(long segmentLength, long seekInterval) {
+    if (segmentLength <= 0) {
+        return seekInterval;
+    }
+    long nSpans = (segmentLength + seekInterval - 1) / seekInterval;
+    return segmentLength / nSpans;
+}
+
+//
+// *This function returns the size of the jump table in front of the
+// streams of a coded block.
+//
+long streamJumpSize(int nStreams) {
+    return (nStreams > 1) ? 4L * nStreams : 0;
+}
+
+//
+// *This function codes a block with table and appends the bits to
+// job.output, split into options.nStreams streams behind a jump table when
+// there is more than one.
+//
+void encodeStreams(const char* data, long length, CodeEntry table[],
+                   BlockOptions &options, BlockJob &job) {
+    if (options.nStreams <= 1) {
+        bitwriter bits;
+        encodeBlock(data, length, table, bits, options.seekInterval,
+                    job.seekBits);
+        job.output += bits.bytes();
+        return;
+    }
+    long segmentLength = streamSegmentLength(length, options.nStreams,
+                                             options.seekInterval);
+    long spanLength = streamSpanLength(segmentLength, options.seekInterval);
+    string jump;
+    string streams;
+    putU32(jump, segmentLength);
+    for (int s = 0; s < options.nStreams; s++) {
+        long begin = min(length, s * segmentLength);
+        long end = min(length, begin + segmentLength);
+        bitwriter bits;
+        vector<uint32_t> points;
+        encodeBlock(data + begin, end - begin, table, bits, spanLength,
+                    points);
+        for (uint32_t point : points) {
+            job.seekBits.push_back(streams.size() * 8 + point);
+        }
+        streams += bits.bytes();
+        if (s + 1 < options.nStreams) {
+            putU32(jump, streams.size());
+        }
+    }
+    job.output += jump;
+    job.output += streams;
+}
+
+//
+// *This function decodes like blockdecoder by walking tree one bit at a time.
+// It handles codes of any length.
+//
+void decodeBlockTree(const char* data, long nBytes, long firstBit,
+                     HuffmanNode* tree, char* out, long length) {
+    bitreader input(data, nBytes, firstBit);
+    for (long i = 0; i < length; i++) {
+        HuffmanNode* curr = tree;
+        while (curr->character == NOT_A_CHAR) {
+            int bit = input.readBit();
+            if (bit == EOF) {
+                throw runtime_error("Truncated block!");
+            }
+            curr = (bit == 1) ? curr->one : curr->zero;
+        }
+        out[i] = (char)curr->character;
+    }
+}
+
+//
+// blockdecoder:
+// Decodes the coded bits of every block that uses one tree.  The decode
+// kernel is picked from the longest code: an 11 bit table for typical text,
+// a 15 bit table for wider alphabets, and the tree walk for anything
+// longer.  The table is built once, so a codebook or a block whose seek
+// spans are read one at a time pays for it once instead of per decode.
+//
+class blockdecoder {
+ public:
+    blockdecoder(shared_ptr<HuffmanNode> tree) : tree(tree) {
+        CodeEntry codes[PSEUDO_EOF + 1];
+        buildCodeTable(tree.get(), codes);
+        int longest = maxCodeLength(codes);
+        if (longest <= 11) {
+            narrow.reset(new decodekernel<11>(codes));
+            if (!narrow->complete()) {
+                narrow.reset();
+            }
+        } else if (longest <= 15) {
+            wide.reset(new decodekernel<15>(codes));
+            if (!wide->complete()) {
+                wide.reset();
+            }
+        }
+    }
+
+    //
+    // decode:
+    // Decodes length bytes from the bits in data, starting at bit firstBit.
+    //
+    void decode(const char* data, long nBytes, long firstBit, char* out,
+                long length) const {
+        if (narrow) {
+            narrow->decode(data, nBytes, firstBit, out, length);
+        } else if (wide) {
+            wide->decode(data, nBytes, firstBit, out, length);
+        } else {
+            decodeBlockTree(data, nBytes, firstBit, tree.get(), out, length);
+        }
+    }
+
+    //
+    // decodeStreams:
+    // Decodes nStreams streams, stream s of nBytes[s] bytes into length[s]
+    // bytes at out[s].
+    //
+    void decodeStreams(int nStreams, const char* data[], const long nBytes[],
+                       char* out[], const long length[]) const {
+        if (narrow) {
+            narrow->decodeStreams(nStreams, data, nBytes, out, length);
+        } else if (wide) {
+            wide->decodeStreams(nStreams, data, nBytes, out, length);
+        } else {
+            for (int s = 0; s < nStreams; s++) {
+                decodeBlockTree(data[s], nBytes[s], 0, tree.get(), out[s],
+                                length[s]);
+            }
+        }
+    }
+
+ private:
+    shared_ptr<HuffmanNode> tree;
+    unique_ptr<decodekernel<11> > narrow;  // set if every code fits 11 bits
+    unique_ptr<decodekernel<15> > wide;  // else set if every code fits 15
+};
+
+//
+// *This function returns the decoder of a codebook, building it the first
+// time any thread asks.  Codebook trees are freed with the codebook, so the
+// decoder does not own it.
+//
+shared_ptr<blockdecoder> codebookDecoder(Codebook* book) {
+    call_once(book->decoderOnce, [book]() {
+        book->decoder = make_shared<blockdecoder>(
+            shared_ptr<HuffmanNode>(book->tree, [](HuffmanNode*) {}));
+    });
+    return book->decoder;
+}
+
+//
+// *This function decodes the bits of a coded block written by
+// encodeStreams into length bytes at out.
+//
+void decodeStreams(const char* data, long nBytes,
+                   const blockdecoder &decoder, char* out, long length,
+                   int nStreams) {
+    if (nStreams <= 1) {
+        decoder.decode(data, nBytes, 0, out, length);
+        return;
+    }
+    long jumpSize = streamJumpSize(nStreams);
+    if (nBytes < jumpSize) {
+        throw runtime_error("Truncated block!");
+    }
+    long segmentLength = getU32(data);
+    if (segmentLength * nStreams < length) {
+        throw runtime_error("Bad stream table!");
+    }
+    const char* streams[MAX_STREAMS];
+    long sizes[MAX_STREAMS];
+    char* outs[MAX_STREAMS];
+    long lengths[MAX_STREAMS];
+    long begin = 0;
+    for (int s = 0; s < nStreams; s++) {
+        long end = (s + 1 < nStreams) ? (long)getU32(data + 4 * (s + 1))
+                   : nBytes - jumpSize;
+        if (end < begin || end > nBytes - jumpSize) {
+            throw runtime_error("Bad stream table!");
+        }
+        streams[s] = data + jumpSize + begin;
+        sizes[s] = end - begin;
+        long outBegin = min(length, s * segmentLength);
+        outs[s] = out + outBegin;
+        lengths[s] = min(length, outBegin + segmentLength) - outBegin;
+        begin = end;
+    }
+    decoder.decodeStreams(nStreams, streams, sizes, outs, lengths);
+}
+
+//
+// *This function writes the header of one block record.
+//
+void writeBlockRecord(int fd, int type, long rawLength, long payloadLength) {
+    string record;
+    record += (char)type;
+    putU32(record, rawLength);
+    putU32(record, payloadLength);
+    writeAll(fd, record.data(), record.size());
+}
+
+//
+// *This function checks the header of a block record read from a file.
+// Throws if the type is unknown or a raw block's payload is not its raw
+// bytes.
+//
+void checkBlockRecord(int type, long rawLength, long payloadLength) {
+    if (type != BLOCK_HUFFMAN && type != BLOCK_RAW && type != BLOCK_CODEBOOK) {
+        throw runtime_error("Bad block type!");
+    }
+    if (type == BLOCK_RAW && payloadLength != rawLength) {
+        throw runtime_error("Bad raw block!");
+    }
+}
+
+//
+// *This function is the coder stage of compressBlocks.  It builds the
+// block's tree from a full or sampled histogram and either encodes the block
+// into job.output or, when the estimated coded size is not smaller than the
+// block itself, marks it to be stored raw.  If shared is not nullptr and
+// coding with that codebook is smaller than both, the block only refers to
+// it by id.  Otherwise a codebook from options.cache is used when the cache
+// finds one close enough to the block's own tree.
+//
+void codeBlock(BlockJob &job, BlockOptions &options, Codebook* shared) {
+    const char* data = job.input.data();
+    long length = job.rawLength;
+    long counts[BYTE_VALUES] = {0};
+    if (options.sampleSlices > 0) {
+        sampleBytes(data, length, options.sampleSlices, DEFAULT_SLICE_SIZE,
+                    counts);
+    } else {
+        countBytes(data, length, counts);
+    }
+
+    hashmap frequencyMap;
+    histogramFrequencyMap(counts, options.sampleSlices > 0, frequencyMap);
+    HuffmanNode* tree = buildEncodingTree(frequencyMap);
+    CodeEntry table[PSEUDO_EOF + 1];
+    buildCodeTable(tree, table);
+    freeTree(tree);
+
+    job.output.clear();
+    job.seekBits.clear();
+    long jumpSize = streamJumpSize(options.nStreams);
+    long coded = estimateCodedSize(counts, table) + jumpSize;
+    bool cached = false;
+    if (shared == nullptr && options.cache != nullptr && coded < length) {
+        shared = options.cache->find(
+            counts, 8.0 * (coded - jumpSize - CODEBOOK_REF_SIZE));
+        cached = (shared != nullptr);
+    }
+    long sharedCoded = (shared == nullptr) ? -1
+                       : codebookCodedSize(shared, counts) + CODEBOOK_REF_SIZE
+                         + jumpSize;
+    if (sharedCoded > jumpSize + CODEBOOK_REF_SIZE
+        && (cached || sharedCoded < coded)
+        && sharedCoded < length) {
+        job.type = BLOCK_CODEBOOK;
+        putCodebookRef(job.output, shared);
+        encodeStreams(data, length, shared->table, options, job);
+        return;
+    }
+    if (coded >= length) {
+        job.type = BLOCK_RAW;
+        return;
+    }
+    job.type = BLOCK_HUFFMAN;
+    putU16(job.output, frequencyMap.size() - 1);
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        int key = (int)(char)i;
+        if (frequencyMap.containsKey(key)) {
+            job.output += (char)i;
+            putU32(job.output, frequencyMap.get(key));
+        }
+    }
+    encodeStreams(data, length, table, options, job);
+}
+
+//
+// *This function returns the seek table and trailer of a file whose index
+// starts at indexOffset.
+//
+string blockIndexBytes(long indexOffset, vector<SeekBlock> &index,
+                       long seekInterval) {
+    string out;
+    for (SeekBlock &entry : index) {
+        putU64(out, entry.rawOffset);
+        putU64(out, entry.recordOffset);
+        putU32(out, entry.seekBits.size());
+        for (uint32_t bit : entry.seekBits) {
+            putU32(out, bit);
+        }
+    }
+    putU64(out, indexOffset);
+    putU32(out, index.size());
+    putU32(out, seekInterval);
+    out.append(BLOCKFILE_INDEX_MAGIC, 4);
+    return out;
+}
+
+//
+// *This function writes the seek table and trailer at indexOffset, the
+// current end of fd, and returns their size.
+//
+long writeBlockIndex(int fd, long indexOffset, vector<SeekBlock> &index,
+                     long seekInterval) {
+    string out = blockIndexBytes(indexOffset, index, seekInterval);
+    writeAll(fd, out.data(), out.size());
+    return out.size();
+}
+
+//
+// *This function returns the number of streams per coded block from a
+// block file header.
+//
+int blockStreams(const char* header) {
+    if (!(header[5] & BLOCKFILE_STREAMS)) {
+        return 1;
+    }
+    int nStreams = getU16(header + 6);
+    if (nStreams < 1 || nStreams > MAX_STREAMS) {
+        throw runtime_error("Bad stream count!");
+    }
+    return nStreams;
+}
+
+//
+// *This function reads the nBlocks entries of an index of indexSize bytes,
+// stored at indexOffset, from data into index.  Returns false, leaving
+// index in any state, unless the entries fill the index exactly and only
+// refer to records between the header and the index.
+//
+bool parseIndexEntries(const char* data, long indexSize, long nBlocks,
+                       long indexOffset, vector<SeekBlock> &index) {
+    if (indexSize < 20 * nBlocks) {
+        return false;
+    }
+    long pos = 0;
+    index.assign(nBlocks, SeekBlock());
+    for (SeekBlock &entry : index) {
+        if (pos + 20 > indexSize) {
+            return false;
+        }
+        entry.rawOffset = getU64(data + pos);
+        entry.recordOffset = getU64(data + pos + 8);
+        long nPoints = getU32(data + pos + 16);
+        pos += 20;
+        if (entry.recordOffset < BLOCKFILE_HEADER_SIZE
+            || entry.recordOffset + BLOCK_RECORD_SIZE > indexOffset
+            || nPoints > (indexSize - pos) / 4) {
+            return false;
+        }
+        for (long k = 0; k < nPoints; k++) {
+            entry.seekBits.push_back(getU32(data + pos));
+            pos += 4;
+        }
+    }
+    return pos == indexSize;
+}
+
+//
+// *This function reads the index whose trailer ends at end into index.
+// Returns false, leaving index in any state, unless there is a trailer at
+// end and it points at an index that parseIndexEntries accepts.
+//
+bool parseBlockIndex(int fd, long end, vector<SeekBlock> &index,
+                     long &seekInterval, long &indexOffset) {
+    if (end < BLOCKFILE_HEADER_SIZE + BLOCKFILE_TRAILER_SIZE) {
+        return false;
+    }
+    char trailer[BLOCKFILE_TRAILER_SIZE];
+    preadAll(fd, trailer, BLOCKFILE_TRAILER_SIZE, end - BLOCKFILE_TRAILER_SIZE);
+    indexOffset = getU64(trailer);
+    long nBlocks = getU32(trailer + 8);
+    long indexSize = end - BLOCKFILE_TRAILER_SIZE - indexOffset;
+    if (memcmp(trailer + 16, BLOCKFILE_INDEX_MAGIC, 4) != 0
+        || indexOffset < BLOCKFILE_HEADER_SIZE || indexSize < 20 * nBlocks) {
+        return false;
+    }
+    seekInterval = getU32(trailer + 12);
+    string data;
+    data.resize(indexSize);
+    preadAll(fd, &data[0], data.size(), indexOffset);
+    return parseIndexEntries(data.data(), indexSize, nBlocks, indexOffset,
+                             index);
+}
+
+//
+// *This function reads the seek table of a block file into index.  It
+// returns the offset where the blocks end: the index offset, or the file
+// size for files written without an index.  The last trailer is normally
+// at the end of the file; if an append was cut short, the file is searched
+// backwards for the last trailer that is complete.
+//
+long readBlockIndex(int fd, vector<SeekBlock> &index, long &seekInterval) {
+    char header[BLOCKFILE_HEADER_SIZE];
+    preadAll(fd, header, BLOCKFILE_HEADER_SIZE, 0);
+    if (memcmp(header, BLOCKFILE_MAGIC, 4) != 0) {
+        throw runtime_error("Not a block file!");
+    }
+    long fileSize = lseek(fd, 0, SEEK_END);
+    index.clear();
+    seekInterval = 0;
+    if (!(header[5] & BLOCKFILE_INDEXED)) {
+        return fileSize;
+    }
+    long indexOffset;
+    if (parseBlockIndex(fd, fileSize, index, seekInterval, indexOffset)) {
+        return indexOffset;
+    }
+    // chunks overlap by the magic's length minus one so no match is split
+    const long chunkSize = 64 * 1024;
+    string chunk;
+    long hi = fileSize;
+    while (hi > BLOCKFILE_HEADER_SIZE) {
+        long lo = max((long)BLOCKFILE_HEADER_SIZE, hi - chunkSize);
+        long readEnd = min(fileSize, hi + 3);
+        chunk.resize(readEnd - lo);
+        preadAll(fd, &chunk[0], chunk.size(), lo);
+        for (long i = min((long)chunk.size(), hi - lo + 3) - 4; i >= 0; i--) {
+            long end = lo + i + 4;
+            if (end < fileSize
+                && memcmp(chunk.data() + i, BLOCKFILE_INDEX_MAGIC, 4) == 0
+                && parseBlockIndex(fd, end, index, seekInterval, indexOffset)) {
+                return indexOffset;
+            }
+        }
+        hi = lo;
+    }
+    index.clear();
+    seekInterval = 0;
+    throw runtime_error("Block file index is missing!");
+}
+
+//
+// *This function opens filename with flags, throwing if it cannot.
+//
+int openFile(string filename, int flags) {
+    int fd = open(filename.c_str(), flags, 0644);
+    if (fd < 0) {
+        throw runtime_error("Cannot open " + filename);
+    }
+    return fd;
+}
+
+//
+// *This function codes the bytes of inFd from rawStart to its end as blocks
+// written at the current end of outFd, whose size is outSize.  Blocks go
+// through a reader, coder and writer stage (see pipeline.h), so reading the
+// next block, coding this one and writing the last one overlap.  Each block
+// is coded with its own tree, or copied raw when that would not be larger.
+// Index entries get raw offsets from rawBase on and are added to index.
+// With options.verify, every check has passed by the time this returns.
+// Returns the new size of outFd.
+//
+long writeBlocks(int inFd, long rawStart, long rawBase, int outFd,
+                 long outSize, BlockOptions &options, vector<SeekBlock> &index,
+                 PipelineStats &stats) {
+    long fileSize = lseek(inFd, 0, SEEK_END);
+    uringreader reader(options.uringDepth);
+    stats.bufferSize = options.blockSize;
+    stats.usedUring = reader.usingUring();
+    long nextOffset = rawStart;
+    ReadStage read = [&](BlockJob &job) {
+        if (nextOffset >= fileSize) {
+            return false;
+        }
+        job.rawOffset = rawBase + nextOffset - rawStart;
+        job.rawLength = min(options.blockSize, fileSize - nextOffset);
+        job.input.resize(job.rawLength);
+        reader.readAt(inFd, job.input.data(), job.rawLength, nextOffset);
+        nextOffset += job.rawLength;
+        return true;
+    };
+    CodeStage code = [&](BlockJob &job) {
+        codeBlock(job, options, nullptr);
+        if (options.verify != nullptr) {
+            options.verify->check(job, options.nStreams);
+        }
+    };
+    WriteStage write = [&](BlockJob &job) {
+        SeekBlock entry;
+        entry.rawOffset = job.rawOffset;
+        entry.recordOffset = outSize;
+        entry.seekBits = job.seekBits;
+        index.push_back(entry);
+        if (job.type == BLOCK_RAW) {
+            // the reader already has the bytes, so write them rather than
+            // having the kernel copy them from the input again
+            writeBlockRecord(outFd, BLOCK_RAW, job.rawLength, job.rawLength);
+            writeAll(outFd, job.input.data(), job.rawLength);
+            outSize += BLOCK_RECORD_SIZE + job.rawLength;
+        } else {
+            writeBlockRecord(outFd, job.type, job.rawLength, job.output.size());
+            writeAll(outFd, job.output.data(), job.output.size());
+            outSize += BLOCK_RECORD_SIZE + job.output.size();
+        }
+    };
+    lseek(outFd, outSize, SEEK_SET);
+    runPipeline(read, code, write, options.queueDepth, stats);
+    if (options.verify != nullptr) {
+        options.verify->finish();
+    }
+    return outSize;
+}
+
+//
+// *This function checks the block size and stream count of options.
+//
+void checkBlockOptions(BlockOptions &options) {
+    if (options.blockSize <= 0 || options.blockSize > MAX_BLOCK_SIZE) {
+        throw invalid_argument("Bad block size!");
+    }
+    if (options.nStreams != 1 && options.nStreams != 4
+        && options.nStreams != 8) {
+        throw invalid_argument("Bad stream count!");
+    }
+}
+
+//
+// *This function compresses filename into filename + ".hufb" with
+// writeBlocks.  With options.cache, blocks may refer to a cached codebook
+// instead of their own tree, and the histogram of the blocks that did not
+// is added to the cache.  If anything fails, including a check of
+// options.verify, the output file is removed.  Returns the size of the
+// compressed file and fills stats.
+//
+long compressBlocks(string filename, BlockOptions options,
+                    PipelineStats &stats) {
+    checkBlockOptions(options);
+    int inFd = openFile(filename, O_RDONLY);
+    posix_fadvise(inFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    int outFd = -1;
+    long outSize = 0;
+    try {
+        outFd = openFile(filename + ".hufb", O_WRONLY | O_CREAT | O_TRUNC);
+
+        string header(BLOCKFILE_MAGIC, 4);
+        header += (char)BLOCKFILE_VERSION;
+        header += (char)(BLOCKFILE_INDEXED
+                         | (options.nStreams > 1 ? BLOCKFILE_STREAMS : 0));
+        putU16(header, options.nStreams);
+        putU32(header, options.blockSize);
+        writeAll(outFd, header.data(), header.size());
+        outSize = header.size();
+
+        vector<SeekBlock> index;
+        outSize = writeBlocks(inFd, 0, 0, outFd, outSize, options, index,
+                              stats);
+        outSize += writeBlockIndex(outFd, outSize, index, options.seekInterval);
+        if (options.cache != nullptr) {
+            options.cache->commit();
+        }
+    } catch (...) {
+        close(inFd);
+        if (outFd >= 0) {
+            close(outFd);
+            unlink((filename + ".hufb").c_str());
+        }
+        throw;
+    }
+    close(inFd);
+    close(outFd);
+    return outSize;
+}
+
+//
+// *This function adds the contents of filename to the end of the data in
+// the block file target without touching its existing blocks.  The new
+// blocks and a new index covering old and new blocks are written after the
+// old trailer and synced, and only then is the new trailer written and
+// synced, so a trailer never points at data that is not on disk.  The old
+// index is left behind as dead bytes; readers only follow the last one.  If
+// anything fails the file is truncated back to its old size.  Block size,
+// stream count and seek interval come from target.  Returns the new size
+// of target.
+//
+long appendBlocks(string target, string filename, BlockOptions options,
+                  PipelineStats &stats) {
+    int outFd = openFile(target, O_RDWR);
+    int inFd = -1;
+    long oldSize = lseek(outFd, 0, SEEK_END);
+    long outSize = oldSize;
+    try {
+        char header[BLOCKFILE_HEADER_SIZE];
+        preadAll(outFd, header, BLOCKFILE_HEADER_SIZE, 0);
+        if (memcmp(header, BLOCKFILE_MAGIC, 4) != 0
+            || !(header[5] & BLOCKFILE_INDEXED)) {
+            throw runtime_error(target + " is not an indexed block file");
+        }
+        vector<SeekBlock> index;
+        readBlockIndex(outFd, index, options.seekInterval);
+        options.blockSize = getU32(header + 8);
+        options.nStreams = blockStreams(header);
+        checkBlockOptions(options);
+        long rawBase = 0;
+        if (!index.empty()) {
+            char record[BLOCK_RECORD_SIZE];
+            preadAll(outFd, record, BLOCK_RECORD_SIZE,
+                     index.back().recordOffset);
+            rawBase = index.back().rawOffset + getU32(record + 1);
+        }
+
+        inFd = openFile(filename, O_RDONLY);
+        posix_fadvise(inFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        outSize = writeBlocks(inFd, 0, rawBase, outFd, outSize, options,
+                              index, stats);
+        string out = blockIndexBytes(outSize, index, options.seekInterval);
+        long indexSize = out.size() - BLOCKFILE_TRAILER_SIZE;
+        writeAll(outFd, out.data(), indexSize);
+        if (fsync(outFd) != 0) {
+            throw runtime_error("Write failed!");
+        }
+        writeAll(outFd, out.data() + indexSize, BLOCKFILE_TRAILER_SIZE);
+        if (fsync(outFd) != 0) {
+            throw runtime_error("Write failed!");
+        }
+        outSize += out.size();
+        if (options.cache != nullptr) {
+            options.cache->commit();
+        }
+    } catch (...) {
+        if (ftruncate(outFd, oldSize) == 0) {
+            fsync(outFd);
+        }
+        close(outFd);
+        if (inFd >= 0) {
+            close(inFd);
+        }
+        throw;
+    }
+    close(inFd);
+    close(outFd);
+    return outSize;
+}
+
+//
+// *This function returns the name decompressed output is written to.  If
+// filename = "example.txt.hufb" then "example_unc.txt" is returned.
+//
+string uncompressedName(string filename, string suffix) {
+    size_t pos = filename.rfind(suffix);
+    if (pos != string::npos) {
+        filename = filename.substr(0, pos);
+    }
+    pos = filename.rfind(".");
+    if (pos == string::npos) {
+        return filename + "_unc";
+    }
+    return filename.substr(0, pos) + "_unc" + filename.substr(pos);
+}
+
+//
+// *This function rebuilds the tree of a Huffman block from its frequency
+// table and returns the offset of the coded bits within the payload.
+// Throws if the table does not fit in the payload's length bytes.
+//
+long readBlockTree(const char* payload, long length, HuffmanNode* &tree) {
+    if (length < 2) {
+        throw runtime_error("Bad block tree!");
+    }
+    int nSymbols = getU16(payload);
+    if (nSymbols > BYTE_VALUES || 2 + 5L * nSymbols > length) {
+        throw runtime_error("Bad block tree!");
+    }
+    long offset = 2;
+    hashmap frequencyMap;
+    for (int i = 0; i < nSymbols; i++) {
+        frequencyMap.put((int)payload[offset], getU32(payload + offset + 1));
+        offset += 5;
+    }
+    frequencyMap.put(PSEUDO_EOF, 1);
+    tree = buildEncodingTree(frequencyMap);
+    return offset;
+}
+
+//
+// *This function is the coder stage of decompressBlocks.  It decodes a
+// Huffman or codebook block from job.input into job.output.  Codebook id 0
+// refers to local, the table stored in an archive, and any other id to a
+// trained or compiled in codebook.  nStreams is the stream count from the
+// file header.
+//
+void decodeBlockJob(BlockJob &job, Codebook* local, int nStreams) {
+    if (job.type == BLOCK_RAW) {
+        return;
+    }
+    if (job.type != BLOCK_HUFFMAN && job.type != BLOCK_CODEBOOK) {
+        throw runtime_error("Bad block type!");
+    }
+    if (job.type == BLOCK_CODEBOOK) {
+        if ((long)job.input.size() < CODEBOOK_REF_SIZE) {
+            throw runtime_error("Bad codebook block!");
+        }
+        int id = (unsigned char)job.input[0];
+        Codebook* book = (id == 0) ? local : getCodebook(id);
+        checkCodebookRef(book, job.input.data() + 1);
+        job.output.resize(job.rawLength);
+        decodeStreams(job.input.data() + CODEBOOK_REF_SIZE,
+                      job.input.size() - CODEBOOK_REF_SIZE,
+                      *codebookDecoder(book), &job.output[0], job.rawLength,
+                      nStreams);
+        return;
+    }
+    HuffmanNode* tree = nullptr;
+    long offset = readBlockTree(job.input.data(), job.input.size(), tree);
+    blockdecoder decoder(shared_ptr<HuffmanNode>(tree, freeTree));
+    job.output.resize(job.rawLength);
+    decodeStreams(job.input.data() + offset, job.input.size() - offset,
+                  decoder, &job.output[0], job.rawLength, nStreams);
+}
+
+//
+// *This function fills index from the block records between the header and
+// blocksEnd, for files written without an index.
+//
+void scanBlocks(int fd, long blocksEnd, vector<SeekBlock> &index) {
+    long offset = BLOCKFILE_HEADER_SIZE;
+    long rawOffset = 0;
+    index.clear();
+    while (offset < blocksEnd) {
+        char record[BLOCK_RECORD_SIZE];
+        preadAll(fd, record, BLOCK_RECORD_SIZE, offset);
+        checkBlockRecord(record[0], getU32(record + 1), getU32(record + 5));
+        SeekBlock entry;
+        entry.rawOffset = rawOffset;
+        entry.recordOffset = offset;
+        index.push_back(entry);
+        rawOffset += getU32(record + 1);
+        offset += BLOCK_RECORD_SIZE + getU32(record + 5);
+    }
+}
+
+//
+// *This function reverses compressBlocks.  Given "example.txt.hufb" it writes
+// "example_unc.txt" and returns the number of bytes written.  Blocks are
+// visited in index order, since appended files hold dead old indexes
+// between their blocks; files without an index are scanned first.  Raw
+// blocks are never read by the reader stage; the writer copies them with
+// copy_file_range.
+//
+long decompressBlocks(string filename, BlockOptions options,
+                      PipelineStats &stats) {
+    int inFd = openFile(filename, O_RDONLY);
+    posix_fadvise(inFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    int outFd = -1;
+    long total = 0;
+    try {
+        char header[BLOCKFILE_HEADER_SIZE];
+        if (!readAll(inFd, header, BLOCKFILE_HEADER_SIZE)
+            || memcmp(header, BLOCKFILE_MAGIC, 4) != 0) {
+            throw runtime_error(filename + " is not a block file");
+        }
+        vector<SeekBlock> index;
+        long seekInterval;
+        long blocksEnd = readBlockIndex(inFd, index, seekInterval);
+        if (!(header[5] & BLOCKFILE_INDEXED)) {
+            scanBlocks(inFd, blocksEnd, index);
+        }
+        string outName = uncompressedName(filename, ".hufb");
+        outFd = openFile(outName, O_WRONLY | O_CREAT | O_TRUNC);
+        stats.bufferSize = getU32(header + 8);
+        int nStreams = blockStreams(header);
+
+        long next = 0;
+        ReadStage read = [&](BlockJob &job) {
+            if (next >= (long)index.size()) {
+                return false;
+            }
+            char record[BLOCK_RECORD_SIZE];
+            long recordOffset = index[next++].recordOffset;
+            preadAll(inFd, record, BLOCK_RECORD_SIZE, recordOffset);
+            job.type = record[0];
+            job.rawOffset = total;
+            job.rawLength = getU32(record + 1);
+            long payloadLength = getU32(record + 5);
+            checkBlockRecord(job.type, job.rawLength, payloadLength);
+            job.sourceOffset = recordOffset + BLOCK_RECORD_SIZE;
+            if (job.type == BLOCK_RAW) {
+                job.input.clear();
+            } else {
+                job.input.resize(payloadLength);
+                preadAll(inFd, job.input.data(), payloadLength,
+                         job.sourceOffset);
+            }
+            total += job.rawLength;
+            return true;
+        };
+        CodeStage code = [&](BlockJob &job) {
+            decodeBlockJob(job, nullptr, nStreams);
+        };
+        WriteStage write = [&](BlockJob &job) {
+            if (job.type == BLOCK_RAW) {
+                copyRange(inFd, job.sourceOffset, outFd, job.rawLength);
+            } else {
+                writeAll(outFd, job.output.data(), job.rawLength);
+            }
+        };
+        runPipeline(read, code, write, options.queueDepth, stats);
+    } catch (...) {
+        close(inFd);
+        if (outFd >= 0) {
+            close(outFd);
+        }
+        throw;
+    }
+    close(inFd);
+    close(outFd);
+    return total;
+}
@@ -0,0 +1,521 @@
+// File Name : btreemap.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : a map with the interface of mymap kept in a B+ tree of
+//               wide nodes, so a lookup reads a few cache lines per level
+//               instead of chasing one node per key
+// Data : 04/12/2022
+
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include "memstats.h"
+
+using namespace std;
+
+//
+// btreemap:
+// Every key and value is kept in the leaves, ORDER to a leaf, and the
+// leaves are linked in order so iteration never climbs the tree.  Inner
+// nodes only hold separator keys: children[i] has the keys below keys[i]
+// and children[i + 1] those at or above it.  Nodes split when they are
+// full; like mymap, keys are never removed one at a time.
+//
+template<typename keyType, typename valueType, int ORDER = 32>
+class btreemap {
+    static_assert(ORDER >= 3, "btreemap nodes need room for 3 keys");
+
+ private:
+    struct NODE {
+        int n;  // keys in use
+        bool isLeaf;
+        keyType keys[ORDER];
+
+        static void* operator new(size_t size) {
+            countAlloc(MEM_BTREE_NODE, size);
+            return ::operator new(size);
+        }
+        static void operator delete(void* p, size_t size) {
+            countFree(MEM_BTREE_NODE, size);
+            ::operator delete(p);
+        }
+    };
+    struct LEAF : NODE {
+        valueType values[ORDER];
+        LEAF* next;  // next leaf in order
+    };
+    struct INNER : NODE {
+        NODE* children[ORDER + 1];
+    };
+
+    NODE* root;
+    int size;  // # of key/value pairs in the btreemap
+
+    //
+    // iterator:
+    // Walks the keys in order along the leaf links, so that btreemap works
+    // with a foreach loop.
+    //
+    struct iterator {
+     private:
+        LEAF* leaf;  // nullptr at end
+        int index;  // key of leaf the iterator is on
+
+     public:
+        iterator(LEAF* leaf, int index) {
+            this->leaf = leaf;
+            this->index = index;
+        }
+
+        keyType operator *() {
+            return leaf->keys[index];
+        }
+
+        bool operator ==(const iterator& rhs) {
+            return leaf == rhs.leaf && index == rhs.index;
+        }
+
+        bool operator !=(const iterator& rhs) {
+            return !(*this == rhs);
+        }
+
+        bool isDefault() {
+            return !leaf;
+        }
+
+        //
+        // operator++:
+        // Advances to the next key in order.  O(1)
+        //
+        iterator operator++() {
+            if (++index == leaf->n) {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+    };
+
+    //
+    // _newLeaf
+    //
+    // creates an empty leaf
+    LEAF* _newLeaf() {
+        LEAF* leaf = new LEAF();
+        leaf->n = 0;
+        leaf->isLeaf = true;
+        leaf->next = nullptr;
+        return leaf;
+    }
+
+    //
+    // _newInner
+    //
+    // creates an inner node with no keys
+    INNER* _newInner() {
+        INNER* inner = new INNER();
+        inner->n = 0;
+        inner->isLeaf = false;
+        return inner;
+    }
+
+    //
+    // _findLeaf
+    //
+    // descends from the root to the leaf that holds key if it is in the
+    // map, or nullptr if the map is empty
+    LEAF* _findLeaf(const keyType &key) {
+        NODE* curr = root;
+        if (curr == nullptr) {
+            return nullptr;
+        }
+        while (!curr->isLeaf) {
+            INNER* inner = (INNER*)curr;
+            int i = upper_bound(inner->keys, inner->keys + inner->n, key)
+                    - inner->keys;
+            curr = inner->children[i];
+        }
+        return (LEAF*)curr;
+    }
+
+    //
+    // _find
+    //
+    // returns the position of key in its leaf and sets leaf, or returns -1
+    int _find(const keyType &key, LEAF* &leaf) {
+        leaf = _findLeaf(key);
+        if (leaf == nullptr) {
+            return -1;
+        }
+        int i = lower_bound(leaf->keys, leaf->keys + leaf->n, key)
+                - leaf->keys;
+        return (i < leaf->n && leaf->keys[i] == key) ? i : -1;
+    }
+
+    //
+    // _leafInsert
+    //
+    // puts key and value at position i of a leaf that has room
+    void _leafInsert(LEAF* leaf, int i, keyType &key, valueType &value) {
+        for (int j = leaf->n; j > i; j--) {
+            leaf->keys[j] = leaf->keys[j - 1];
+            leaf->values[j] = leaf->values[j - 1];
+        }
+        leaf->keys[i] = key;
+        leaf->values[i] = value;
+        leaf->n++;
+    }
+
+    //
+    // _innerInsert
+    //
+    // puts separator key at position i of an inner node that has room,
+    // with child to its right
+    void _innerInsert(INNER* inner, int i, keyType &key, NODE* child) {
+        for (int j = inner->n; j > i; j--) {
+            inner->keys[j] = inner->keys[j - 1];
+            inner->children[j + 1] = inner->children[j];
+        }
+        inner->keys[i] = key;
+        inner->children[i + 1] = child;
+        inner->n++;
+    }
+
+    //
+    // _insert
+    //
+    // puts key and value below node.  If node had to split, returns the new
+    // right half and sets splitKey to the first key under it; otherwise
+    // returns nullptr.  added is set when the key was not there before.
+    NODE* _insert(NODE* node, keyType &key, valueType &value,
+                  keyType &splitKey, bool &added) {
+        if (node->isLeaf) {
+            LEAF* leaf = (LEAF*)node;
+            int i = lower_bound(leaf->keys, leaf->keys + leaf->n, key)
+                    - leaf->keys;
+            if (i < leaf->n && leaf->keys[i] == key) {
+                leaf->values[i] = value;
+                return nullptr;
+            }
+            added = true;
+            if (leaf->n < ORDER) {
+                _leafInsert(leaf, i, key, value);
+                return nullptr;
+            }
+            LEAF* right = _newLeaf();
+            int mid = ORDER / 2;
+            for (int j = mid; j < ORDER; j++) {
+                right->keys[j - mid] = leaf->keys[j];
+                right->values[j - mid] = leaf->values[j];
+            }
+            right->n = ORDER - mid;
+            leaf->n = mid;
+            right->next = leaf->next;
+            leaf->next = right;
+            if (i <= mid) {
+                _leafInsert(leaf, i, key, value);
+            } else {
+                _leafInsert(right, i - mid, key, value);
+            }
+            splitKey = right->keys[0];
+            return right;
+        }
+
+        INNER* inner = (INNER*)node;
+        int i = upper_bound(inner->keys, inner->keys + inner->n, key)
+                - inner->keys;
+        keyType childKey;
+        NODE* child = _insert(inner->children[i], key, value, childKey, added);
+        if (child == nullptr) {
+            return nullptr;
+        }
+        if (inner->n < ORDER) {
+            _innerInsert(inner, i, childKey, child);
+            return nullptr;
+        }
+        // keys[mid] moves up; children 0 to mid stay on the left
+        INNER* right = _newInner();
+        int mid = ORDER / 2;
+        for (int j = mid + 1; j < ORDER; j++) {
+            right->keys[j - mid - 1] = inner->keys[j];
+        }
+        for (int j = mid + 1; j <= ORDER; j++) {
+            right->children[j - mid - 1] = inner->children[j];
+        }
+        right->n = ORDER - mid - 1;
+        inner->n = mid;
+        splitKey = inner->keys[mid];
+        if (i <= mid) {
+            _innerInsert(inner, i, childKey, child);
+        } else {
+            _innerInsert(right, i - mid - 1, childKey, child);
+        }
+        return right;
+    }
+
+    //
+    // _clear
+    //
+    // deletes node and every node below it
+    void _clear(NODE* node) {
+        if (node == nullptr) {
+            return;
+        }
+        if (node->isLeaf) {
+            delete (LEAF*)node;
+            return;
+        }
+        INNER* inner = (INNER*)node;
+        for (int i = 0; i <= inner->n; i++) {
+            _clear(inner->children[i]);
+        }
+        delete inner;
+    }
+
+    //
+    // _copy
+    //
+    // copies the nodes below other and returns the copy.  prevLeaf is the
+    // last leaf copied so far, so the copied leaves are linked in order.
+    NODE* _copy(NODE* other, LEAF* &prevLeaf) {
+        if (other == nullptr) {
+            return nullptr;
+        }
+        if (other->isLeaf) {
+            LEAF* leaf = _newLeaf();
+            *leaf = *(LEAF*)other;
+            leaf->next = nullptr;
+            if (prevLeaf != nullptr) {
+                prevLeaf->next = leaf;
+            }
+            prevLeaf = leaf;
+            return leaf;
+        }
+        INNER* inner = _newInner();
+        *inner = *(INNER*)other;
+        for (int i = 0; i <= inner->n; i++) {
+            inner->children[i] = _copy(((INNER*)other)->children[i], prevLeaf);
+        }
+        return inner;
+    }
+
+    //
+    // _firstLeaf
+    //
+    // returns the leftmost leaf, or nullptr if the map is empty
+    LEAF* _firstLeaf() {
+        NODE* curr = root;
+        if (curr == nullptr) {
+            return nullptr;
+        }
+        while (!curr->isLeaf) {
+            curr = ((INNER*)curr)->children[0];
+        }
+        return (LEAF*)curr;
+    }
+
+ public:
+    //
+    // default constructor:
+    //
+    // Creates an empty btreemap.
+    // Time complexity: O(1)
+    //
+    btreemap() {
+        root = nullptr;
+        size = 0;
+    }
+
+    //
+    // copy constructor:
+    //
+    // Constructs a new btreemap which is a copy of the "other" btreemap.
+    // Time complexity: O(n)
+    //
+    btreemap(const btreemap& other) {
+        LEAF* prevLeaf = nullptr;
+        root = _copy(other.root, prevLeaf);
+        size = other.size;
+    }
+
+    //
+    // operator=:
+    //
+    // Clears "this" btreemap and then makes a copy of the "other" btreemap.
+    // Time complexity: O(n)
+    //
+    btreemap& operator=(const btreemap& other) {
+        if (this == &other) {
+            return *this;
+        }
+        clear();
+        LEAF* prevLeaf = nullptr;
+        root = _copy(other.root, prevLeaf);
+        size = other.size;
+        return *this;
+    }
+
+    //
+    // clear:
+    //
+    // Frees the memory associated with the btreemap.
+    // Time complexity: O(n)
+    //
+    void clear() {
+        _clear(root);
+        root = nullptr;
+        size = 0;
+    }
+
+    //
+    // destructor:
+    //
+    // Frees the memory associated with the btreemap.
+    // Time complexity: O(n)
+    //
+    ~btreemap() {
+        _clear(root);
+    }
+
+    //
+    // put:
+    //
+    // Inserts the key/value, or replaces the value if key is already there.
+    // Time complexity: O(ORDER * log n) in the worst case, where a full node
+    // on every level splits.
+    //
+    void put(keyType key, valueType value) {
+        if (root == nullptr) {
+            root = _newLeaf();
+        }
+        keyType splitKey;
+        bool added = false;
+        NODE* right = _insert(root, key, value, splitKey, added);
+        if (right != nullptr) {
+            INNER* newRoot = _newInner();
+            newRoot->n = 1;
+            newRoot->keys[0] = splitKey;
+            newRoot->children[0] = root;
+            newRoot->children[1] = right;
+            root = newRoot;
+        }
+        if (added) {
+            size++;
+        }
+    }
+
+    //
+    // contains:
+    // Returns true if the key is in btreemap, return false if not.
+    // Time complexity: O(log n)
+    //
+    bool contains(keyType key) {
+        LEAF* leaf;
+        return _find(key, leaf) >= 0;
+    }
+
+    //
+    // get:
+    //
+    // Returns the value for the given key; if the key is not found, the
+    // default value, valueType(), is returned (but not added to btreemap).
+    // Time complexity: O(log n)
+    //
+    valueType get(keyType key) {
+        LEAF* leaf;
+        int i = _find(key, leaf);
+        return (i < 0) ? valueType() : leaf->values[i];
+    }
+
+    //
+    // operator[]:
+    //
+    // Returns the value for the given key; if the key is not found,
+    // the default value, valueType(), is returned (and the resulting new
+    // key/value pair is inserted into the map).
+    // Time complexity: O(log n)
+    //
+    valueType operator[](keyType key) {
+        LEAF* leaf;
+        int i = _find(key, leaf);
+        if (i >= 0) {
+            return leaf->values[i];
+        }
+        put(key, valueType());
+        return valueType();
+    }
+
+    //
+    // Size:
+    //
+    // Returns the # of key/value pairs in the btreemap, 0 if empty.
+    // O(1)
+    //
+    int Size() {
+        return size;
+    }
+
+    //
+    // begin:
+    //
+    // returns an iterator to the first key in order, or end() if the map
+    // is empty.
+    // Time complexity: O(log n)
+    //
+    iterator begin() {
+        LEAF* leaf = _firstLeaf();
+        return (size == 0) ? end() : iterator(leaf, 0);
+    }
+
+    //
+    // end:
+    //
+    // returns an iterator past the last key.
+    // Time Complexity: O(1)
+    //
+    iterator end() {
+        return iterator(nullptr, 0);
+    }
+
+    //
+    // toString:
+    //
+    // Returns a string of the entire btreemap, in order, in the format of
+    // mymap::toString: "key: 8 value: 80\nkey: 15 value: 150\n"
+    // Time complexity: O(n)
+    //
+    string toString() {
+        stringstream ss;
+        for (LEAF* leaf = _firstLeaf(); leaf != nullptr; leaf = leaf->next) {
+            for (int i = 0; i < leaf->n; i++) {
+                ss << "key: " << leaf->keys[i] << " value: "
+                   << leaf->values[i] << endl;
+            }
+        }
+        return ss.str();
+    }
+
+    //
+    // toVector:
+    //
+    // Returns a vector of the entire map, in order.  For 8/80, 15/150, 20/200:
+    // {{8, 80}, {15, 150}, {20, 200}}
+    // Time complexity: O(n)
+    //
+    vector<pair<keyType, valueType> > toVector() {
+        vector<pair<keyType, valueType> > v;
+        v.reserve(size);
+        for (LEAF* leaf = _firstLeaf(); leaf != nullptr; leaf = leaf->next) {
+            for (int i = 0; i < leaf->n; i++) {
+                v.push_back(pair<keyType, valueType>(leaf->keys[i],
+                                                     leaf->values[i]));
+            }
+        }
+        return v;
+    }
+};
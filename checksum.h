@@ -0,0 +1,150 @@
+// File Name : checksum.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : CRC-32 checksums used to check archive members, and
+//               SHA-256 for verifying round trips
+// Data : 04/12/2022
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+//
+// *This function returns the CRC-32 (IEEE polynomial) lookup table.  It is
+// built once, the first time any thread needs it.
+//
+const uint32_t* crc32Table() {
+    static Crc32Table table;
+    return table.entries;
+}
+
+//
+// *This function continues the CRC-32 crc over length bytes of data.  Start
+// with crc = 0.
+//
+uint32_t crc32(uint32_t crc, const char* data, long length) {
+    const uint32_t* table = crc32Table();
+    crc = ~crc;
+    for (long i = 0; i < length; i++) {
+        crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+//
+// *This function rotates x right by n bits.
+//
+uint32_t rotateRight(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+//
+// *This function mixes one 64 byte chunk into the SHA-256 state.
+//
+void sha256Chunk(uint32_t state[8], const unsigned char* chunk) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)chunk[4 * i] << 24 | (uint32_t)chunk[4 * i + 1] << 16
+               | (uint32_t)chunk[4 * i + 2] << 8 | chunk[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18)
+                      ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19)
+                      ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t v[8];
+    for (int i = 0; i < 8; i++) {
+        v[i] = state[i];
+    }
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = rotateRight(v[4], 6) ^ rotateRight(v[4], 11)
+                      ^ rotateRight(v[4], 25);
+        uint32_t choose = (v[4] & v[5]) ^ (~v[4] & v[6]);
+        uint32_t t1 = v[7] + s1 + choose + SHA256_K[i] + w[i];
+        uint32_t s0 = rotateRight(v[0], 2) ^ rotateRight(v[0], 13)
+                      ^ rotateRight(v[0], 22);
+        uint32_t majority = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+        uint32_t t2 = s0 + majority;
+        for (int j = 7; j > 0; j--) {
+            v[j] = v[j - 1];
+        }
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++) {
+        state[i] += v[i];
+    }
+}
+
+//
+// *This function returns the 32 byte SHA-256 digest of length bytes of
+// data.
+//
+string sha256(const char* data, long length) {
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f,
+        0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    const unsigned char* bytes = (const unsigned char*)data;
+    long full = length / 64 * 64;
+    for (long i = 0; i < full; i += 64) {
+        sha256Chunk(state, bytes + i);
+    }
+    // the rest, a one bit, zeros and the length in bits fill one or two
+    // more chunks
+    unsigned char tail[128] = {0};
+    long rest = length - full;
+    for (long i = 0; i < rest; i++) {
+        tail[i] = bytes[full + i];
+    }
+    tail[rest] = 0x80;
+    int tailSize = (rest < 56) ? 64 : 128;
+    uint64_t bits = (uint64_t)length * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailSize - 1 - i] = (unsigned char)(bits >> (8 * i));
+    }
+    for (int i = 0; i < tailSize; i += 64) {
+        sha256Chunk(state, tail + i);
+    }
+    string digest;
+    for (int i = 0; i < 8; i++) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            digest += (char)(state[i] >> shift);
+        }
+    }
+    return digest;
+}
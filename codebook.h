@@ -0,0 +1,395 @@
+// File Name : codebook.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : trained static codebooks so small files can be coded
+//               without a frequency map header or a per-file tree
+// Data : 04/12/2022
+
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "util.h"
+#include "checksum.h"
+#include "snapshotmap.h"
+
+//
+// A codebook table holds one count per unsigned byte value (0..255)
+// followed by the count for PSEUDO_EOF.
+//
+const int CODEBOOK_SYMBOLS = 257;
+
+//
+// Ids the train command may save a codebook under.  Id 0 is an archive's
+// own table and ids from CACHE_FIRST_ID (codebookcache.h) on are written by
+// the codebook cache.
+//
+const int TRAINED_FIRST_ID = 1;
+const int TRAINED_LAST_ID = 127;
+
+//
+// Bytes a file or block spends naming its codebook: the u8 id followed by
+// the u32 hash of the codebook's counts, which is checked when the file is
+// decoded so a codebook that was replaced under the same id fails loudly.
+//
+const int CODEBOOK_REF_SIZE = 5;
+
+#include "codebooks_builtin.h"
+
+struct CodeEntry {
+    uint64_t bits;  // code, first bit in the lowest bit
+    int length;
+};
+
+class blockdecoder;
+
+struct Codebook {
+    int id;
+    uint32_t hash;  // codebookHash() of counts
+    int counts[CODEBOOK_SYMBOLS];
+    HuffmanNode* tree;
+    mymap<int, string> encodingMap;
+    CodeEntry table[CODEBOOK_SYMBOLS];  // codes indexed by unsigned byte
+    shared_ptr<blockdecoder> decoder;  // built by codebookDecoder()
+    once_flag decoderOnce;
+};
+
+//
+// *This function converts a codebook table index into the key used by the
+// frequency map.  Bytes are read as plain chars everywhere else, so bytes
+// above 127 are stored under negative keys.
+//
+int codebookKey(int index) {
+    if (index == PSEUDO_EOF) {
+        return PSEUDO_EOF;
+    }
+    return (int)(char)index;
+}
+
+//
+// *This function returns the CRC-32 of a codebook table, each count taken
+// as a little endian u32.
+//
+uint32_t codebookHash(const int counts[]) {
+    uint32_t hash = 0;
+    for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+        char bytes[4];
+        for (int k = 0; k < 4; k++) {
+            bytes[k] = (char)(((uint32_t)counts[i] >> (8 * k)) & 0xFF);
+        }
+        hash = crc32(hash, bytes, 4);
+    }
+    return hash;
+}
+
+//
+// *This function appends the id and hash of book to out, as read back by
+// checkCodebookRef().
+//
+void putCodebookRef(string &out, const Codebook* book) {
+    out += (char)book->id;
+    for (int k = 0; k < 4; k++) {
+        out += (char)((book->hash >> (8 * k)) & 0xFF);
+    }
+}
+
+//
+// *This function reads the u32 hash that follows a codebook id and throws
+// if book is unknown or was built from other counts than the file was
+// written with.
+//
+void checkCodebookRef(const Codebook* book, const char* hashBytes) {
+    if (book == nullptr) {
+        throw runtime_error("Unknown codebook!");
+    }
+    uint32_t hash = 0;
+    for (int k = 0; k < 4; k++) {
+        hash |= (uint32_t)(unsigned char)hashBytes[k] << (8 * k);
+    }
+    if (hash != book->hash) {
+        throw runtime_error("Codebook " + to_string(book->id)
+                            + " does not match the one the data was "
+                            "written with!");
+    }
+}
+
+//
+// *This function throws if id is not one the train command may use.
+//
+void checkTrainedId(int id) {
+    if (id < TRAINED_FIRST_ID || id > TRAINED_LAST_ID) {
+        throw invalid_argument("Codebook ids must be "
+                               + to_string(TRAINED_FIRST_ID) + " to "
+                               + to_string(TRAINED_LAST_ID) + "!");
+    }
+}
+
+//
+// *This function fills map with the counts of a codebook table.  The keys are
+// always inserted in the same order so the encoder and decoder build the
+// exact same tree.
+//
+void codebookFrequencyMap(const int counts[], hashmap &map) {
+    for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+        map.put(codebookKey(i), counts[i]);
+    }
+}
+
+//
+// *This function builds a shared codebook from a sample corpus.  Every byte
+// value and PSEUDO_EOF gets a count of at least one so any input can be
+// encoded with the trained codebook.  Codebook counts are ints, so large
+// corpora are scaled down to fit.
+//
+void trainCodebook(vector<string> &samples, int counts[]) {
+    hashmap frequencyMap;
+    for (string &sample : samples) {
+        buildFrequencyMap(sample, true, frequencyMap);
+    }
+    rescaleFrequencyMap(frequencyMap, INT32_MAX);
+    for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+        int key = codebookKey(i);
+        counts[i] = frequencyMap.containsKey(key) ? frequencyMap.get(key) : 1;
+    }
+}
+
+//
+// *This function writes a codebook table to codebook_<id>.cb, where
+// getCodebook() finds it at run time.
+//
+void saveCodebookTable(int id, const int counts[]) {
+    ofstream table("codebook_" + to_string(id) + ".cb");
+    for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+        table << counts[i] << endl;
+    }
+}
+
+//
+// *This function writes a trained codebook to codebook_<id>.cb so it can be
+// loaded at run time, and to codebook_<id>.h as a constexpr table which can
+// be added to codebooks_builtin.h to compile the codebook into the binary.
+// Throws if id is outside TRAINED_FIRST_ID to TRAINED_LAST_ID.
+//
+void saveCodebook(int id, const int counts[]) {
+    checkTrainedId(id);
+    string name = "codebook_" + to_string(id);
+    saveCodebookTable(id, counts);
+    ofstream header(name + ".h");
+    header << "// generated by the train command from a sample corpus" << endl;
+    header << "constexpr int CODEBOOK_" << id << "[CODEBOOK_SYMBOLS] = {";
+    for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+        header << (i % 12 == 0 ? "\n    " : " ") << counts[i];
+        if (i < CODEBOOK_SYMBOLS - 1) {
+            header << ",";
+        }
+    }
+    header << endl << "};" << endl;
+}
+
+//
+// walks the tree and stores the code of each leaf, first bit lowest
+//
+void _buildCodeTable(HuffmanNode* n, uint64_t bits, int depth,
+                     CodeEntry table[]) {
+    if (n->character != NOT_A_CHAR) {
+        int index = (n->character == PSEUDO_EOF)
+                    ? PSEUDO_EOF : (unsigned char)n->character;
+        table[index].bits = bits;
+        table[index].length = depth;
+        return;
+    }
+    _buildCodeTable(n->zero, bits, depth + 1, table);
+    _buildCodeTable(n->one, bits | ((uint64_t)1 << depth), depth + 1, table);
+}
+
+//
+// *This function builds a flat code table indexed by unsigned byte value
+// (PSEUDO_EOF at 256) from an encoding tree.
+//
+void buildCodeTable(HuffmanNode* tree, CodeEntry table[]) {
+    for (int i = 0; i <= PSEUDO_EOF; i++) {
+        table[i].bits = 0;
+        table[i].length = 0;
+    }
+    _buildCodeTable(tree, 0, 0, table);
+}
+
+//
+// *This function builds the tree, encoding map, code table and hash of a
+// codebook from its counts.
+//
+void buildCodebook(Codebook* book) {
+    book->hash = codebookHash(book->counts);
+    hashmap frequencyMap;
+    codebookFrequencyMap(book->counts, frequencyMap);
+    book->tree = buildEncodingTree(frequencyMap);
+    book->encodingMap = buildEncodingMap(book->tree);
+    buildCodeTable(book->tree, book->table);
+}
+
+//
+// *This function estimates the bytes needed to code counts with a codebook,
+// or returns -1 if some byte in counts has no code in it.
+//
+long codebookCodedSize(Codebook* book, const long counts[]) {
+    long bits = 0;
+    for (int i = 0; i < PSEUDO_EOF; i++) {
+        if (counts[i] > 0) {
+            if (book->table[i].length == 0) {
+                return -1;
+            }
+            bits += counts[i] * book->table[i].length;
+        }
+    }
+    return (bits + 7) / 8;
+}
+
+//
+// *This function reads a codebook table from codebook_<id>.cb.  It returns
+// false if the file does not exist or is incomplete.
+//
+bool loadCodebookFile(int id, int counts[]) {
+    ifstream table("codebook_" + to_string(id) + ".cb");
+    for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+        if (!(table >> counts[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// *This function returns the codebook with the given id, building its tree
+// and encoding map the first time it is used.  Compiled in codebooks are
+// checked before codebook files.  Returns nullptr if the id is unknown.
+// Blocks are decoded on several threads, so codebooks that are already
+// loaded are found without a lock; only loading one takes the lock.
+//
+Codebook* getCodebook(int id) {
+    static snapshotmap<int, Codebook*> registry;
+    static mutex loadLock;
+    Codebook* book = registry.get(id);
+    if (book != nullptr) {
+        return book;
+    }
+    lock_guard<mutex> lock(loadLock);
+    book = registry.get(id);  // another thread may have loaded it meanwhile
+    if (book != nullptr) {
+        return book;
+    }
+    book = new Codebook;
+    book->id = id;
+    bool found = false;
+    for (const BuiltinCodebook &builtin : BUILTIN_CODEBOOKS) {
+        if (builtin.id == id) {
+            for (int i = 0; i < CODEBOOK_SYMBOLS; i++) {
+                book->counts[i] = builtin.counts[i];
+            }
+            found = true;
+        }
+    }
+    if (!found && !loadCodebookFile(id, book->counts)) {
+        delete book;
+        return nullptr;
+    }
+    buildCodebook(book);
+    registry.put(id, book);
+    return book;
+}
+
+//
+// *This function returns the shared encoding tree of a codebook so
+// decompress() can decode files written by compressWithCodebook().
+// hashBytes are the four hash bytes that follow the id in the file.
+//
+HuffmanNode* codebookTree(int id, const char* hashBytes) {
+    Codebook* book = getCodebook(id);
+    checkCodebookRef(book, hashBytes);
+    return book->tree;
+}
+
+//
+// *This function compresses filename using a trained codebook instead of a
+// frequency map header.  The output file starts with '@', the codebook id
+// and its hash, followed directly by the encoded bits.  Returns the size of
+// the output file in bytes.
+//
+long compressWithCodebook(string filename, int id) {
+    Codebook* book = (id >= 0 && id <= 255) ? getCodebook(id) : nullptr;
+    if (book == nullptr) {
+        throw invalid_argument("Unknown codebook!");
+    }
+    ofbitstream output(filename + ".huf");
+    output.put('@');
+    string ref;
+    putCodebookRef(ref, book);
+    for (char c : ref) {
+        output.put(c);
+    }
+    ifstream input(filename);
+    long bits = encodeStream(input, book->encodingMap, output);
+    return 1 + CODEBOOK_REF_SIZE + (bits + 7) / 8;
+}
+
+//
+// *This function codes a short message in memory with a trained codebook.
+// The returned bytes hold the codebook id and hash followed by the encoded
+// bits.
+//
+string compressMessage(const string &message, int id) {
+    Codebook* book = (id >= 0 && id <= 255) ? getCodebook(id) : nullptr;
+    if (book == nullptr) {
+        throw invalid_argument("Unknown codebook!");
+    }
+    ostringbitstream output;
+    string ref;
+    putCodebookRef(ref, book);
+    for (char c : ref) {
+        output.put(c);
+    }
+    for (char c : message) {
+        for (char bit : book->encodingMap.get((int)c)) {
+            output.writeBit(bit == '1' ? 1 : 0);
+        }
+    }
+    for (char bit : book->encodingMap.get(PSEUDO_EOF)) {
+        output.writeBit(bit == '1' ? 1 : 0);
+    }
+    return output.str();
+}
+
+//
+// *This function reverses compressMessage.
+//
+string decompressMessage(const string &bytes) {
+    if ((long)bytes.size() < CODEBOOK_REF_SIZE) {
+        throw invalid_argument("Message too short!");
+    }
+    Codebook* book = getCodebook((unsigned char)bytes[0]);
+    checkCodebookRef(book, bytes.data() + 1);
+    bitreader input(bytes.data() + CODEBOOK_REF_SIZE,
+                    bytes.size() - CODEBOOK_REF_SIZE);
+    string str = "";
+    HuffmanNode* curr = book->tree;
+    while (true) {
+        int bit = input.readBit();
+        if (bit == EOF) {
+            break;
+        }
+        curr = (bit == 1) ? curr->one : curr->zero;
+        if (curr->character == PSEUDO_EOF) {
+            break;
+        } else if (curr->character != NOT_A_CHAR) {
+            str += (char)curr->character;
+            curr = book->tree;
+        }
+    }
+    return str;
+}
@@ -0,0 +1,278 @@
+// File Name : codebookcache.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : a compressor side cache of codebooks built from earlier
+//               files, so similar files can refer to one by id instead of
+//               carrying their own frequency table
+// Data : 04/12/2022
+
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "util.h"
+#include "codebook.h"
+#include "histogram.h"
+
+using namespace std;
+
+const char CODEBOOK_CACHE_FILE[] = "codebook_cache.txt";
+const int CACHE_FIRST_ID = 128;  // ids below are left for trained codebooks
+const int CACHE_LAST_ID = 255;
+const long FINGERPRINT_SHARE = 4096;
+const double DEFAULT_REUSE_THRESHOLD = 0.02;
+
+//
+// *This function returns the fingerprint of a histogram: bit g is set when
+// bytes 4g to 4g + 3 make up at least 1 / FINGERPRINT_SHARE of the data.
+// Files with the same alphabet share a fingerprint even when the order of
+// their most common bytes differs, and a few stray bytes do not change it.
+//
+uint64_t histogramFingerprint(const long counts[]) {
+    long total = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        total += counts[b];
+    }
+    uint64_t fingerprint = 0;
+    for (int g = 0; g < 64; g++) {
+        long group = counts[4 * g] + counts[4 * g + 1] + counts[4 * g + 2]
+                     + counts[4 * g + 3];
+        if (group > 0 && group >= total / FINGERPRINT_SHARE) {
+            fingerprint |= (uint64_t)1 << g;
+        }
+    }
+    return fingerprint;
+}
+
+//
+// *This function returns the bits needed to code counts with table, or -1 if
+// some byte in counts has no code.
+//
+double tableCodedBits(const long counts[], const CodeEntry table[]) {
+    double bits = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        if (counts[b] > 0) {
+            if (table[b].length == 0) {
+                return -1;
+            }
+            bits += (double)counts[b] * table[b].length;
+        }
+    }
+    return bits;
+}
+
+//
+// codebookcache:
+// Codebooks built from the histograms of earlier files, stored as
+// codebook_<id>.cb with ids CACHE_FIRST_ID to CACHE_LAST_ID and indexed by
+// fingerprint in CODEBOOK_CACHE_FILE.  Compressed files refer to entries by
+// id, so entries are never evicted or renumbered; once every id is taken
+// new histograms are simply not added.  Histograms that miss are summed
+// until commit() stores them as one new entry.  Callers commit once per
+// batch (a block file, or the files of one CC run), so a batch takes at
+// most one of the 128 ids however many of its files miss.  Hit and miss
+// totals are kept in the index file across runs.
+//
+class codebookcache {
+ public:
+    codebookcache(double threshold) {
+        this->threshold = threshold;
+        totalHits = 0;
+        totalMisses = 0;
+        hits = 0;
+        misses = 0;
+        clearPending();
+        ifstream index(CODEBOOK_CACHE_FILE);
+        index >> totalHits >> totalMisses;
+        Entry entry;
+        while (index >> entry.id >> entry.fingerprint) {
+            // loaded up front so find() never reads codebook files from
+            // the coder thread
+            entry.book = getCodebook(entry.id);
+            if (entry.book != nullptr) {
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    //
+    // find:
+    // Returns the cached codebook to code counts with, or nullptr.  Only
+    // entries with the same fingerprint are tried, and one is only used if
+    // it costs at most threshold more than ownBits, the cost of coding
+    // counts with their own tree and header.  Counts a hit or a miss; the
+    // counts of a miss are kept for commit().
+    //
+    Codebook* find(const long counts[], double ownBits) {
+        Codebook* best = nullptr;
+        double bestBits = 0;
+        uint64_t fingerprint = histogramFingerprint(counts);
+        for (Entry &entry : entries) {
+            if (entry.fingerprint != fingerprint) {
+                continue;
+            }
+            double bits = tableCodedBits(counts, entry.book->table);
+            if (bits >= 0 && (best == nullptr || bits < bestBits)) {
+                best = entry.book;
+                bestBits = bits;
+            }
+        }
+        if (best != nullptr && bestBits <= ownBits * (1 + threshold)) {
+            hits++;
+            return best;
+        }
+        misses++;
+        hasPending = true;
+        for (int b = 0; b < BYTE_VALUES; b++) {
+            pending[b] += counts[b];
+        }
+        return nullptr;
+    }
+
+    //
+    // commit:
+    // Stores a codebook built from the counts that missed since the last
+    // commit and returns its id, or -1 if nothing missed or every cache id
+    // is taken.  Ids whose codebook file already exists are never reused,
+    // even if the index lost them, since files may still refer to them.
+    // Bytes that never occur get a count of one so later files can use
+    // every byte value.
+    //
+    int commit() {
+        int id = CACHE_FIRST_ID;
+        while (id <= CACHE_LAST_ID && _taken(id)) {
+            id++;
+        }
+        if (!hasPending || id > CACHE_LAST_ID) {
+            clearPending();
+            return -1;
+        }
+        int table[CODEBOOK_SYMBOLS];
+        long largest = *max_element(pending, pending + BYTE_VALUES);
+        // codebook counts are ints, so large files are scaled down
+        double scale = (largest > INT32_MAX) ? (double)INT32_MAX / largest : 1;
+        for (int b = 0; b < BYTE_VALUES; b++) {
+            table[b] = max(1L, (long)(pending[b] * scale));
+        }
+        table[PSEUDO_EOF] = 1;
+        saveCodebookTable(id, table);
+        Entry entry;
+        entry.id = id;
+        entry.fingerprint = histogramFingerprint(pending);
+        clearPending();
+        entry.book = getCodebook(id);
+        if (entry.book == nullptr) {
+            return -1;
+        }
+        entries.push_back(entry);
+        return id;
+    }
+
+    //
+    // save:
+    // Writes the index and the hit and miss totals.
+    //
+    void save() {
+        ofstream index(CODEBOOK_CACHE_FILE);
+        index << totalHits + hits << " " << totalMisses + misses << endl;
+        for (Entry &entry : entries) {
+            index << entry.id << " " << entry.fingerprint << endl;
+        }
+    }
+
+    //
+    // printStats:
+    // Prints the hit rate of this run and of every run so far.
+    //
+    void printStats() {
+        long allHits = totalHits + hits;
+        long allMisses = totalMisses + misses;
+        cout << "Codebook cache: " << entries.size() << " entries, this run "
+             << hits << " hits / " << misses << " misses, all runs "
+             << allHits << " / " << allMisses;
+        if (allHits + allMisses > 0) {
+            cout << " (" << 100.0 * allHits / (allHits + allMisses)
+                 << "% hit rate)";
+        }
+        cout << endl;
+    }
+
+ private:
+    struct Entry {
+        int id;
+        uint64_t fingerprint;
+        Codebook* book;
+    };
+
+    vector<Entry> entries;
+    double threshold;  // extra cost allowed for reuse, 0.02 = 2%
+    long totalHits;  // from earlier runs
+    long totalMisses;
+    long hits;  // this run
+    long misses;
+    long pending[BYTE_VALUES];  // summed counts of misses since commit()
+    bool hasPending;
+
+    //
+    // _taken
+    //
+    // returns true if id is in the index or has a codebook file
+    bool _taken(int id) {
+        for (Entry &entry : entries) {
+            if (entry.id == id) {
+                return true;
+            }
+        }
+        ifstream existing("codebook_" + to_string(id) + ".cb");
+        return existing.good();
+    }
+
+    //
+    // clearPending
+    //
+    // forgets the counts of earlier misses
+    void clearPending() {
+        fill(pending, pending + BYTE_VALUES, 0L);
+        hasPending = false;
+    }
+};
+
+//
+// *This function compresses filename into filename + ".huf", referring to a
+// cached codebook when one is close enough and writing a normal .huf file
+// with its own frequency table otherwise.  A miss adds the file's histogram
+// to the cache's pending counts, which the caller commits after the last
+// file of its batch.  Returns the codebook id used, or -1.
+//
+int compressCached(string filename, codebookcache &cache) {
+    long counts[BYTE_VALUES] = {0};
+    long first[BYTE_VALUES];
+    if (!parallelFileHistogram(filename, thread::hardware_concurrency(),
+                               counts, first)) {
+        throw runtime_error("Cannot open " + filename);
+    }
+    hashmap frequencyMap;
+    histogramFrequencyMap(counts, false, frequencyMap);
+    HuffmanNode* tree = buildEncodingTree(frequencyMap);
+    CodeEntry table[CODEBOOK_SYMBOLS];
+    buildCodeTable(tree, table);
+    freeTree(tree);
+    ostringstream header;
+    header << frequencyMap;
+    // '@', the id and the hash replace the frequency map header
+    double ownBits = tableCodedBits(counts, table) + 8.0 * header.str().size()
+                     - 8.0 * (1 + CODEBOOK_REF_SIZE);
+
+    Codebook* book = cache.find(counts, ownBits);
+    if (book != nullptr) {
+        compressWithCodebook(filename, book->id);
+        return book->id;
+    }
+    compress(filename);
+    return -1;
+}
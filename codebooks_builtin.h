@@ -0,0 +1,44 @@
+// File Name : codebooks_builtin.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : codebooks compiled into the binary.  Paste a table written
+//               by the train command here and list it in BUILTIN_CODEBOOKS.
+// Data : 04/12/2022
+
+#pragma once
+
+struct BuiltinCodebook {
+    int id;
+    const int* counts;
+};
+
+// trained on secertmessage.txt and medium.txt
+constexpr int CODEBOOK_1[CODEBOOK_SYMBOLS] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 63, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 790, 1, 8, 1,
+    1, 1, 1, 23, 4, 6, 1, 1, 37, 7, 27, 1,
+    2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1,
+    1, 1, 1, 1, 1, 5, 2, 3, 4, 1, 2, 5,
+    1, 13, 1, 1, 1, 1, 36, 5, 3, 1, 3, 4,
+    15, 1, 1, 8, 1, 4, 1, 1, 1, 1, 1, 1,
+    1, 292, 43, 100, 130, 484, 62, 125, 118, 243, 3, 27,
+    142, 77, 360, 364, 68, 2, 274, 218, 287, 153, 85, 60,
+    1, 123, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1
+};
+
+constexpr BuiltinCodebook BUILTIN_CODEBOOKS[] = {
+    {1, CODEBOOK_1},
+};
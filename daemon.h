@@ -0,0 +1,603 @@
+// File Name : daemon.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : a long running compression daemon on a Unix domain socket,
+//               and the client side of its protocol.  Clients pass open
+//               file descriptors (files or memfd buffers) instead of names
+//               so the daemon never copies data through the socket.
+// Data : 04/12/2022
+//
+// Protocol (SOCK_SEQPACKET, one request per connection, integers little
+// endian):
+//   request: "HUFD", u8 op, u8 priority, u16 0, u64 0; DAEMON_COMPRESS and
+//            DAEMON_DECOMPRESS pass the input and output descriptors with
+//            SCM_RIGHTS
+//   reply  : u8 status (0 ok), u64 bytes written, message text
+// Compress writes an unindexed block file image to the output descriptor
+// (see compressBuffer) and decompress reverses it.  Both stream one block at
+// a time through the worker's scratch buffers.  Regular files and memfds
+// are read from the start; pipes are read to their end, and an indexed
+// block file has to come from a regular file.  Output is written from the
+// descriptor's current offset, and regular files and memfds are cut to the
+// bytes written.  A client that connects but sends no request within
+// DAEMON_RECEIVE_TIMEOUT is dropped.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "jobpool.h"
+
+using namespace std;
+
+const char DEFAULT_SOCKET[] = "huffman.sock";
+const char DAEMON_MAGIC[] = "HUFD";
+const int DAEMON_REQUEST_SIZE = 16;
+const int DAEMON_COMPRESS = 1;
+const int DAEMON_DECOMPRESS = 2;
+const int DAEMON_STATS = 3;
+const int DAEMON_SHUTDOWN = 4;
+const int DAEMON_MAX_REPLY = 4096;
+const int DAEMON_BACKLOG = 128;
+const int DAEMON_RECEIVE_TIMEOUT = 2;  // seconds to wait for a request
+
+//
+// *This function sends one message on sock with nFds descriptors attached.
+//
+void sendMessage(int sock, const string &bytes, const int fds[], int nFds) {
+    struct iovec io;
+    io.iov_base = (void*)bytes.data();
+    io.iov_len = bytes.size();
+    struct msghdr message = msghdr();
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    if (nFds > 0) {
+        memset(control, 0, sizeof(control));
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(nFds * sizeof(int));
+        struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(nFds * sizeof(int));
+        memcpy(CMSG_DATA(header), fds, nFds * sizeof(int));
+    }
+    while (sendmsg(sock, &message, MSG_NOSIGNAL) < 0) {
+        if (errno != EINTR) {
+            throw runtime_error("Send failed!");
+        }
+    }
+}
+
+//
+// *This function receives one message of at most length bytes from sock
+// into buffer, and up to two attached descriptors into fds.  Returns the
+// message length; nFds is set to the number of descriptors received.
+//
+long receiveMessage(int sock, char* buffer, long length, int fds[],
+                    int &nFds) {
+    struct iovec io;
+    io.iov_base = buffer;
+    io.iov_len = length;
+    struct msghdr message = msghdr();
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    char control[CMSG_SPACE(2 * sizeof(int))];
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t n;
+    while ((n = recvmsg(sock, &message, MSG_CMSG_CLOEXEC)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            throw runtime_error("Receive timed out!");
+        }
+        if (errno != EINTR) {
+            throw runtime_error("Receive failed!");
+        }
+    }
+    nFds = 0;
+    for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET
+            && header->cmsg_type == SCM_RIGHTS) {
+            int count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (int i = 0; i < count; i++) {
+                int fd;
+                memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                if (nFds < 2) {
+                    fds[nFds++] = fd;
+                } else {
+                    close(fd);  // more than a request needs
+                }
+            }
+        }
+    }
+    if (message.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+        for (int i = 0; i < nFds; i++) {
+            close(fds[i]);
+        }
+        throw runtime_error("Message too long!");
+    }
+    return n;
+}
+
+//
+// *This function returns the Unix socket address for path.
+//
+struct sockaddr_un socketAddress(string path) {
+    struct sockaddr_un address = sockaddr_un();
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw invalid_argument("Socket path too long!");
+    }
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+//
+// *This function reads everything fd holds.  Regular files and memfds are
+// read from the start with pread; anything else is read to its end.
+//
+string readDescriptor(int fd) {
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        string data;
+        data.resize(info.st_size);
+        preadAll(fd, &data[0], data.size(), 0);
+        return data;
+    }
+    string data;
+    char chunk[65536];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw runtime_error("Read failed!");
+        }
+        data.append(chunk, n);
+    }
+    return data;
+}
+
+//
+// *This function reads up to length bytes of fd into data, with pread from
+// offset on, or with read from the current position if offset is -1.
+// Returns the number of bytes read, which is only short at the end of fd.
+//
+long readUpTo(int fd, char* data, long length, long offset) {
+    long done = 0;
+    while (done < length) {
+        ssize_t n = (offset < 0) ? read(fd, data + done, length - done)
+                    : pread(fd, data + done, length - done, offset + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            throw runtime_error("Read failed!");
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+//
+// *This function returns the offset to read a descriptor from with
+// readUpTo: 0 for regular files and memfds, -1 for anything else.
+//
+long descriptorStart(int fd) {
+    struct stat info;
+    return (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) ? 0 : -1;
+}
+
+//
+// *This function codes everything inFd holds as a block file image written
+// to outFd, like compressBuffer, but one block at a time: job's buffers
+// hold the current block and nothing else is kept.  Sets bytesRead to the
+// size of the input and returns the number of bytes written.
+//
+long compressDescriptor(int inFd, int outFd, BlockOptions &options,
+                        BlockJob &job, const atomic<bool>* cancel,
+                        long &bytesRead) {
+    string header(BLOCKFILE_MAGIC, 4);
+    header += (char)BLOCKFILE_VERSION;
+    header += (char)(options.nStreams > 1 ? BLOCKFILE_STREAMS : 0);
+    putU16(header, options.nStreams);
+    putU32(header, options.blockSize);
+    writeAll(outFd, header.data(), header.size());
+    long written = header.size();
+    long offset = descriptorStart(inFd);
+    bytesRead = 0;
+    while (true) {
+        if (cancel != nullptr && *cancel) {
+            throw runtime_error("Job cancelled!");
+        }
+        job.input.resize(options.blockSize);
+        job.rawLength = readUpTo(inFd, job.input.data(), options.blockSize,
+                                 offset);
+        if (job.rawLength == 0) {
+            break;
+        }
+        job.input.resize(job.rawLength);
+        if (offset >= 0) {
+            offset += job.rawLength;
+        }
+        bytesRead += job.rawLength;
+        codeBlock(job, options, nullptr);
+        if (job.type == BLOCK_RAW) {
+            writeBlockRecord(outFd, BLOCK_RAW, job.rawLength, job.rawLength);
+            writeAll(outFd, job.input.data(), job.rawLength);
+            written += BLOCK_RECORD_SIZE + job.rawLength;
+        } else {
+            writeBlockRecord(outFd, job.type, job.rawLength, job.output.size());
+            writeAll(outFd, job.output.data(), job.output.size());
+            written += BLOCK_RECORD_SIZE + job.output.size();
+        }
+    }
+    return written;
+}
+
+//
+// *This function reverses compressDescriptor, decoding one block at a time
+// into job's buffers.  Indexed block files are read in index order, so
+// appended files work too.  Sets bytesRead to the bytes of inFd that were
+// read and returns the number of bytes written.
+//
+long decompressDescriptor(int inFd, int outFd, BlockJob &job,
+                          const atomic<bool>* cancel, long &bytesRead) {
+    long offset = descriptorStart(inFd);
+    char header[BLOCKFILE_HEADER_SIZE];
+    if (readUpTo(inFd, header, BLOCKFILE_HEADER_SIZE, offset)
+            != BLOCKFILE_HEADER_SIZE
+        || memcmp(header, BLOCKFILE_MAGIC, 4) != 0) {
+        throw runtime_error("Not a block file!");
+    }
+    int nStreams = blockStreams(header);
+    vector<SeekBlock> index;
+    bool indexed = (header[5] & BLOCKFILE_INDEXED) != 0;
+    if (indexed) {
+        if (offset < 0) {
+            throw runtime_error("Indexed block files must be regular files!");
+        }
+        long seekInterval;
+        readBlockIndex(inFd, index, seekInterval);
+    } else if (offset >= 0) {
+        offset = BLOCKFILE_HEADER_SIZE;
+    }
+    bytesRead = BLOCKFILE_HEADER_SIZE;
+    long written = 0;
+    for (long b = 0; !indexed || b < (long)index.size(); b++) {
+        if (cancel != nullptr && *cancel) {
+            throw runtime_error("Job cancelled!");
+        }
+        if (indexed) {
+            offset = index[b].recordOffset;
+        }
+        char record[BLOCK_RECORD_SIZE];
+        long n = readUpTo(inFd, record, BLOCK_RECORD_SIZE, offset);
+        if (n == 0 && !indexed) {
+            break;
+        }
+        if (n != BLOCK_RECORD_SIZE) {
+            throw runtime_error("Truncated block file!");
+        }
+        job.type = record[0];
+        job.rawLength = getU32(record + 1);
+        long payloadLength = getU32(record + 5);
+        checkBlockRecord(job.type, job.rawLength, payloadLength);
+        if (offset >= 0) {
+            offset += BLOCK_RECORD_SIZE;
+        }
+        job.input.resize(payloadLength);
+        if (readUpTo(inFd, job.input.data(), payloadLength, offset)
+            != payloadLength) {
+            throw runtime_error("Truncated block file!");
+        }
+        if (offset >= 0) {
+            offset += payloadLength;
+        }
+        bytesRead += BLOCK_RECORD_SIZE + payloadLength;
+        if (job.type == BLOCK_RAW) {
+            writeAll(outFd, job.input.data(), job.rawLength);
+        } else {
+            decodeBlockJob(job, nullptr, nStreams);
+            writeAll(outFd, job.output.data(), job.rawLength);
+        }
+        written += job.rawLength;
+    }
+    return written;
+}
+
+//
+// compressiondaemon:
+// Listens on a Unix socket and answers requests until it is asked to shut
+// down.  The accept loop only reads the request and its descriptors; the
+// reading, coding, writing and reply happen on the shared worker pool, so
+// the pool's threads and scratch buffers and the codebook registry stay
+// warm from one request to the next.
+//
+class compressiondaemon {
+ public:
+    compressiondaemon(string path) {
+        this->path = path;
+        served = 0;
+        failed = 0;
+        bytesIn = 0;
+        bytesOut = 0;
+        inFlight = 0;
+        stopping = false;
+        options = defaultBlockOptions();
+        options.queueDepth = 0;
+        listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) {
+            throw runtime_error("Cannot create socket!");
+        }
+        struct sockaddr_un address = socketAddress(path);
+        unlink(path.c_str());  // left behind by a daemon that was killed
+        if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0
+            || listen(listenFd, DAEMON_BACKLOG) != 0) {
+            close(listenFd);
+            throw runtime_error("Cannot listen on " + path);
+        }
+        // start the pool and load the compiled in codebooks now, not on the
+        // first request
+        workerpool::shared();
+        for (const BuiltinCodebook &builtin : BUILTIN_CODEBOOKS) {
+            getCodebook(builtin.id);
+        }
+    }
+
+    ~compressiondaemon() {
+        close(listenFd);
+        unlink(path.c_str());
+    }
+
+    //
+    // run:
+    // Serves requests until a DAEMON_SHUTDOWN request, then waits for the
+    // requests still being coded.
+    //
+    void run() {
+        while (!stopping) {
+            int conn = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (conn < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                throw runtime_error("Accept failed!");
+            }
+            // a client that never sends its request must not stall the
+            // accept loop
+            struct timeval timeout = timeval();
+            timeout.tv_sec = DAEMON_RECEIVE_TIMEOUT;
+            setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                       sizeof(timeout));
+            _request(conn);
+        }
+        unique_lock<mutex> lock(m);
+        idle.wait(lock, [this] { return inFlight == 0; });
+    }
+
+    //
+    // stats:
+    // Returns the request and byte totals as one line of text.
+    //
+    string stats() {
+        workerpool &pool = workerpool::shared();
+        return "served " + to_string(served) + ", failed " + to_string(failed)
+               + ", in " + to_string(bytesIn) + " bytes, out "
+               + to_string(bytesOut) + " bytes, " + to_string(pool.size())
+               + " workers, " + to_string(pool.completedJobs())
+               + " pool jobs";
+    }
+
+ private:
+    string path;
+    int listenFd;
+    BlockOptions options;
+    atomic<long> served;
+    atomic<long> failed;
+    atomic<long> bytesIn;
+    atomic<long> bytesOut;
+    bool stopping;
+    long inFlight;  // requests handed to the pool and not yet answered
+    mutex m;
+    condition_variable idle;
+
+    //
+    // _reply
+    //
+    // sends the reply to a request and closes the connection
+    static void _reply(int conn, int status, long size, string text) {
+        string reply;
+        reply += (char)status;
+        putU64(reply, size);
+        reply += text.substr(0, DAEMON_MAX_REPLY - 9);
+        try {
+            sendMessage(conn, reply, nullptr, 0);
+        } catch (runtime_error &) {
+            // the client went away; nothing to tell it
+        }
+        close(conn);
+    }
+
+    //
+    // _request
+    //
+    // reads one request from conn and answers it or queues it
+    void _request(int conn) {
+        char request[DAEMON_REQUEST_SIZE + 1];
+        int fds[2];
+        int nFds = 0;
+        long n;
+        try {
+            n = receiveMessage(conn, request, sizeof(request), fds, nFds);
+        } catch (runtime_error &e) {
+            _reply(conn, 1, 0, e.what());
+            return;
+        }
+        int op = (n == DAEMON_REQUEST_SIZE
+                  && memcmp(request, DAEMON_MAGIC, 4) == 0) ? request[4] : 0;
+        bool coding = (op == DAEMON_COMPRESS || op == DAEMON_DECOMPRESS);
+        if (!coding || nFds != 2) {
+            for (int i = 0; i < nFds; i++) {
+                close(fds[i]);
+            }
+            if (op == DAEMON_STATS) {
+                _reply(conn, 0, 0, stats());
+            } else if (op == DAEMON_SHUTDOWN) {
+                stopping = true;
+                _reply(conn, 0, 0, "stopping");
+            } else {
+                failed++;
+                _reply(conn, 1, 0, "Bad request!");
+            }
+            return;
+        }
+        int inFd = fds[0];
+        int outFd = fds[1];
+        {
+            lock_guard<mutex> lock(m);
+            inFlight++;
+        }
+        BlockOptions options = this->options;
+        JobTask task = [this, op, inFd, outFd, options](
+                BlockJob &scratch, const atomic<bool>* cancel) {
+            BlockOptions local = options;
+            long start = lseek(outFd, 0, SEEK_CUR);
+            long bytesRead = 0;
+            long written = (op == DAEMON_COMPRESS)
+                ? compressDescriptor(inFd, outFd, local, scratch, cancel,
+                                     bytesRead)
+                : decompressDescriptor(inFd, outFd, scratch, cancel,
+                                       bytesRead);
+            struct stat info;
+            if (start >= 0 && fstat(outFd, &info) == 0
+                && S_ISREG(info.st_mode)) {
+                // drops what an earlier, longer output left behind
+                ftruncate(outFd, start + written);
+            }
+            bytesIn += bytesRead;
+            bytesOut += written;
+            return to_string(written);
+        };
+        JobCallback done = [this, conn, inFd, outFd](const string &result,
+                                                     exception_ptr error) {
+            close(inFd);
+            close(outFd);
+            if (error) {
+                failed++;
+                string text = "Request failed!";
+                try {
+                    rethrow_exception(error);
+                } catch (exception &e) {
+                    text = e.what();
+                }
+                _reply(conn, 1, 0, text);
+            } else {
+                served++;
+                _reply(conn, 0, stol(result), "");
+            }
+            lock_guard<mutex> lock(m);
+            inFlight--;
+            idle.notify_all();
+        };
+        try {
+            workerpool::shared().submitTask(task, request[5], done);
+        } catch (exception &e) {
+            // done only runs for queued jobs, so answer here
+            close(inFd);
+            close(outFd);
+            failed++;
+            _reply(conn, 1, 0, e.what());
+            lock_guard<mutex> lock(m);
+            inFlight--;
+            idle.notify_all();
+        }
+    }
+};
+
+//
+// *This function connects to the daemon at path, sends one request and
+// waits for the reply.  For DAEMON_COMPRESS and DAEMON_DECOMPRESS the input
+// is read from inFd and the result written to outFd.  Returns the number of
+// bytes written and sets text to the reply message; throws if the daemon
+// reports an error.
+//
+long daemonRequest(string path, int op, int inFd, int outFd, int priority,
+                   string &text) {
+    int sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        throw runtime_error("Cannot create socket!");
+    }
+    struct sockaddr_un address = socketAddress(path);
+    if (connect(sock, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        close(sock);
+        throw runtime_error("Cannot connect to " + path);
+    }
+    string request(DAEMON_MAGIC, 4);
+    request += (char)op;
+    request += (char)priority;
+    putU16(request, 0);
+    putU64(request, 0);
+    int fds[2] = {inFd, outFd};
+    bool coding = (op == DAEMON_COMPRESS || op == DAEMON_DECOMPRESS);
+    char reply[DAEMON_MAX_REPLY];
+    long n;
+    int nFds;
+    try {
+        sendMessage(sock, request, fds, coding ? 2 : 0);
+        n = receiveMessage(sock, reply, sizeof(reply), fds, nFds);
+    } catch (...) {
+        close(sock);
+        throw;
+    }
+    close(sock);
+    if (n < 9) {
+        throw runtime_error("Bad reply!");
+    }
+    text.assign(reply + 9, n - 9);
+    if (reply[0] != 0) {
+        throw runtime_error(text);
+    }
+    return getU64(reply + 1);
+}
+
+//
+// *This function asks the daemon at path to code the file inName into
+// outName.  Returns the size of outName.
+//
+long daemonFile(string path, int op, string inName, string outName) {
+    int inFd = openFile(inName, O_RDONLY);
+    int outFd;
+    try {
+        outFd = openFile(outName, O_WRONLY | O_CREAT | O_TRUNC);
+    } catch (...) {
+        close(inFd);
+        throw;
+    }
+    string text;
+    long size;
+    try {
+        size = daemonRequest(path, op, inFd, outFd, PRIORITY_NORMAL, text);
+    } catch (...) {
+        close(inFd);
+        close(outFd);
+        throw;
+    }
+    close(inFd);
+    close(outFd);
+    return size;
+}
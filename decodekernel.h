@@ -0,0 +1,231 @@
+// File Name : decodekernel.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : table driven block decoders, one per lookup table width,
+//               picked from the longest code of the block's tree
+// Data : 04/12/2022
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "bitbuffer.h"
+#include "codebook.h"
+
+using namespace std;
+
+const int MAX_STREAMS = 8;
+
+struct DecodeEntry {
+    uint16_t symbol;
+    uint8_t length;  // length of the code that starts with these bits
+};
+
+//
+// *This function returns the length of the longest code in codes.
+//
+int maxCodeLength(const CodeEntry codes[]) {
+    int longest = 0;
+    for (int i = 0; i <= PSEUDO_EOF; i++) {
+        longest = max(longest, codes[i].length);
+    }
+    return longest;
+}
+
+//
+// decodekernel:
+// Decodes blocks whose codes are all at most TABLE_BITS long.  The next
+// TABLE_BITS bits of input index a table that gives the symbol and the
+// length of its code, so every symbol costs one lookup.  A refill tops the
+// bit buffer up to at least 56 bits without branching, which is enough for
+// 56 / TABLE_BITS symbols, so the inner loop has a fixed trip count.  Input
+// is read 8 bytes at a time until fewer than 8 remain; the tail is read a
+// byte at a time and padded with zeros.  Interleaved blocks decode up to
+// MAX_STREAMS streams at once.
+//
+template<int TABLE_BITS>
+class decodekernel {
+ public:
+    static const int SIZE = 1 << TABLE_BITS;
+    static const int PER_REFILL = 56 / TABLE_BITS;
+
+    //
+    // constructor:
+    // Builds the table from the codes of a tree.  Codes longer than
+    // TABLE_BITS make the kernel incomplete.
+    //
+    decodekernel(const CodeEntry codes[]) : entries(SIZE) {
+        long filled = 0;
+        for (int symbol = 0; symbol <= PSEUDO_EOF; symbol++) {
+            int length = codes[symbol].length;
+            if (length == 0) {
+                continue;
+            }
+            if (length > TABLE_BITS) {
+                filled = -1;
+                break;
+            }
+            // every index whose low length bits are the code
+            for (long high = 0; high < (1L << (TABLE_BITS - length)); high++) {
+                DecodeEntry &entry =
+                    entries[codes[symbol].bits | (high << length)];
+                entry.symbol = symbol;
+                entry.length = length;
+                filled++;
+            }
+        }
+        isComplete = (filled == SIZE);
+    }
+
+    //
+    // complete:
+    // Returns true if every table index starts a code, which holds for any
+    // tree with codes of at most TABLE_BITS bits.
+    //
+    bool complete() const {
+        return isComplete;
+    }
+
+    //
+    // decode:
+    // Decodes length bytes from the bits in data, starting at bit firstBit.
+    // Throws if the bits run out first.
+    //
+    void decode(const char* data, long nBytes, long firstBit, char* out,
+                long length) const {
+        bitcursor cursor;
+        _open(cursor, data, nBytes, firstBit);
+        _run<1>(&cursor, &out, &length);
+    }
+
+    //
+    // decodeStreams:
+    // Decodes nStreams independent streams, stream s of nBytes[s] bytes into
+    // length[s] bytes at out[s].  With 4 or 8 streams the symbols of every
+    // stream are decoded in the same loop, so the lookups of one stream
+    // overlap with those of the others instead of waiting on each other.
+    //
+    void decodeStreams(int nStreams, const char* data[], const long nBytes[],
+                       char* out[], const long length[]) const {
+        bitcursor cursors[MAX_STREAMS];
+        for (int s = 0; s < nStreams; s++) {
+            _open(cursors[s], data[s], nBytes[s], 0);
+        }
+        if (nStreams == 4) {
+            _run<4>(cursors, out, length);
+        } else if (nStreams == 8) {
+            _run<8>(cursors, out, length);
+        } else {
+            for (int s = 0; s < nStreams; s++) {
+                _run<1>(cursors + s, out + s, length + s);
+            }
+        }
+    }
+
+ private:
+    // read position in one stream
+    struct bitcursor {
+        const unsigned char* start;
+        const unsigned char* end;
+        const unsigned char* p;
+        uint64_t buffer;
+        int count;  // valid bits in buffer
+        long padding;  // zero bytes read past end
+    };
+
+    vector<DecodeEntry> entries;
+    bool isComplete;
+
+    //
+    // _open
+    //
+    // points cursor at bit firstBit of data
+    static void _open(bitcursor &cursor, const char* data, long nBytes,
+                      long firstBit) {
+        cursor.start = (const unsigned char*)data + firstBit / 8;
+        cursor.end = (const unsigned char*)data + nBytes;
+        cursor.p = cursor.start;
+        cursor.buffer = 0;
+        cursor.count = 0;
+        cursor.padding = 0;
+        _refillTail(cursor);
+        cursor.buffer >>= firstBit % 8;
+        cursor.count -= firstBit % 8;
+    }
+
+    //
+    // _refillTail
+    //
+    // tops the buffer up to 56..63 bits a byte at a time, reading zeros
+    // past the end
+    static void _refillTail(bitcursor &cursor) {
+        while (cursor.count < 56) {
+            if (cursor.p < cursor.end) {
+                cursor.buffer |= (uint64_t)*cursor.p++ << cursor.count;
+            } else {
+                cursor.padding++;
+            }
+            cursor.count += 8;
+        }
+    }
+
+    //
+    // _symbol
+    //
+    // decodes the next symbol of cursor
+    char _symbol(bitcursor &cursor) const {
+        DecodeEntry entry = entries[cursor.buffer & (SIZE - 1)];
+        cursor.buffer >>= entry.length;
+        cursor.count -= entry.length;
+        return (char)entry.symbol;
+    }
+
+    //
+    // _run
+    //
+    // decodes NSTREAMS streams in lockstep while all of them have 8 bytes of
+    // input and PER_REFILL symbols left, then finishes each one on its own
+    template<int NSTREAMS>
+    void _run(bitcursor cursors[], char* out[], const long length[]) const {
+        long shortest = length[0];
+        for (int s = 1; s < NSTREAMS; s++) {
+            shortest = min(shortest, length[s]);
+        }
+        long i = 0;
+        while (shortest - i >= PER_REFILL) {
+            bool room = true;
+            for (int s = 0; s < NSTREAMS; s++) {
+                room = room && (cursors[s].end - cursors[s].p >= 8);
+            }
+            if (!room) {
+                break;
+            }
+            for (int s = 0; s < NSTREAMS; s++) {
+                bitcursor &c = cursors[s];
+                c.buffer |= loadLE64(c.p) << c.count;
+                c.p += (63 - c.count) >> 3;
+                c.count |= 56;
+            }
+            for (int k = 0; k < PER_REFILL; k++) {
+                for (int s = 0; s < NSTREAMS; s++) {
+                    out[s][i + k] = _symbol(cursors[s]);
+                }
+            }
+            i += PER_REFILL;
+        }
+        for (int s = 0; s < NSTREAMS; s++) {
+            bitcursor &c = cursors[s];
+            for (long j = i; j < length[s]; j++) {
+                _refillTail(c);
+                out[s][j] = _symbol(c);
+            }
+            long consumed = (c.p - c.start + c.padding) * 8 - c.count;
+            if (consumed > (c.end - c.start) * 8) {
+                throw runtime_error("Truncated block!");
+            }
+        }
+    }
+};
@@ -0,0 +1,326 @@
+// File Name : fdbuf.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : a stream buffer over a raw file descriptor with large
+//               buffers, read ahead hints, optional O_DIRECT and output
+//               preallocation.  ifbitstream and ofbitstream sit on it.
+// Data : 04/12/2022
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <ios>
+#include <streambuf>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const long DIRECT_ALIGNMENT = 4096;
+const long DEFAULT_FILE_BUFFER = 1024 * 1024;
+
+struct FileOptions {
+    long bufferSize;  // bytes per read or write system call
+    bool sequential;  // tell the kernel the file is read front to back
+    bool direct;  // bypass the page cache with O_DIRECT where allowed
+    long preallocate;  // bytes to reserve for output up front, 0 for none
+};
+
+//
+// *This function returns the options new file buffers are opened with.
+// Changing them affects every ifbitstream and ofbitstream opened after.
+//
+FileOptions& fileDefaults() {
+    static FileOptions options = {DEFAULT_FILE_BUFFER, true, false, 0};
+    return options;
+}
+
+//
+// fdbuf:
+// A std::streambuf for one file descriptor, used either for reading or for
+// writing.  Reads fill a buffer of options.bufferSize bytes with pread and
+// hint the next buffer to the kernel; writes are collected and written with
+// pwrite when the buffer is full, on seeks out of it, and on close.  tellg,
+// tellp and seeks that stay inside the buffer make no system calls, which
+// matters because the bitstreams call tellg/tellp on every bit.
+//
+// With O_DIRECT, reads start on DIRECT_ALIGNMENT boundaries and only whole
+// aligned blocks are written directly; the first unaligned write turns
+// O_DIRECT off for the rest of the file.  File systems that refuse
+// O_DIRECT are opened without it.
+//
+class fdbuf : public streambuf {
+ public:
+    fdbuf() {
+        fd = -1;
+        buffer = nullptr;
+        options = fileDefaults();
+    }
+
+    ~fdbuf() {
+        close();
+    }
+
+    //
+    // open:
+    // Opens filename for reading (ios::in) or writing (ios::out).  Returns
+    // this, or nullptr if it cannot be opened.
+    //
+    fdbuf* open(const char* filename, ios::openmode mode) {
+        if (fd >= 0) {
+            return nullptr;
+        }
+        writing = (mode & ios::out) != 0;
+        int flags = writing ? (O_WRONLY | O_CREAT | O_TRUNC) : O_RDONLY;
+        direct = false;
+        if (options.direct) {
+            fd = ::open(filename, flags | O_DIRECT, 0644);
+            direct = (fd >= 0);
+        }
+        if (fd < 0) {
+            fd = ::open(filename, flags, 0644);
+        }
+        if (fd < 0) {
+            return nullptr;
+        }
+        bufferSize = max(options.bufferSize, DIRECT_ALIGNMENT);
+        bufferSize = (bufferSize + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT
+                     * DIRECT_ALIGNMENT;
+        void* memory = nullptr;
+        if (posix_memalign(&memory, DIRECT_ALIGNMENT, bufferSize) != 0) {
+            ::close(fd);
+            fd = -1;
+            return nullptr;
+        }
+        buffer = (char*)memory;
+        bufferOffset = 0;
+        extent = 0;
+        reserved = false;
+        if (writing) {
+            if (options.preallocate > 0) {
+                // reserves blocks without changing the file size; file
+                // systems without fallocate just skip it
+                fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, options.preallocate);
+            }
+            setp(buffer, buffer + bufferSize);
+            high = buffer;
+        } else {
+            if (options.sequential) {
+                posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+            setg(buffer, buffer, buffer);
+        }
+        return this;
+    }
+
+    //
+    // close:
+    // Writes what is buffered and closes the file.  Returns this, or nullptr
+    // if the file was not open or the last write failed.
+    //
+    fdbuf* close() {
+        if (fd < 0) {
+            return nullptr;
+        }
+        bool ok = !writing || _flush();
+        if (reserved) {
+            ok = (ftruncate(fd, extent) == 0) && ok;
+        }
+        ok = (::close(fd) == 0) && ok;
+        fd = -1;
+        free(buffer);
+        buffer = nullptr;
+        setg(nullptr, nullptr, nullptr);
+        setp(nullptr, nullptr);
+        return ok ? this : nullptr;
+    }
+
+    bool is_open() const {
+        return fd >= 0;
+    }
+
+    //
+    // reserve:
+    // Allocates bytes of disk for an output file and sets its size to them,
+    // for output whose exact size is known before it is written.  close()
+    // trims the file to the bytes actually written, so a wrong size only
+    // costs the allocation.  Returns false if the file system refused.
+    //
+    bool reserve(long bytes) {
+        if (fd < 0 || !writing || bytes <= 0) {
+            return false;
+        }
+        reserved = (fallocate(fd, 0, 0, bytes) == 0);
+        return reserved;
+    }
+
+    //
+    // usingDirect:
+    // Returns true while the file is read or written with O_DIRECT.
+    //
+    bool usingDirect() const {
+        return direct;
+    }
+
+ protected:
+    int_type underflow() override {
+        if (fd < 0 || writing) {
+            return traits_type::eof();
+        }
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        long next = bufferOffset + (egptr() - eback());
+        long readOffset = direct ? next / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT
+                          : next;
+        long n = 0;
+        while (n < bufferSize) {
+            ssize_t got = pread(fd, buffer + n, bufferSize - n, readOffset + n);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                break;
+            }
+            n += got;
+            if (direct) {
+                break;  // a short O_DIRECT read is the end of the file
+            }
+        }
+        long skip = next - readOffset;
+        bufferOffset = readOffset;
+        if (n <= skip) {
+            setg(buffer, buffer + skip, buffer + skip);
+            return traits_type::eof();
+        }
+        setg(buffer, buffer + skip, buffer + n);
+        if (options.sequential) {
+            posix_fadvise(fd, readOffset + n, bufferSize, POSIX_FADV_WILLNEED);
+        }
+        return traits_type::to_int_type(*gptr());
+    }
+
+    int_type overflow(int_type c) override {
+        if (fd < 0 || !writing || !_flush()) {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        if (writing && !_flush()) {
+            return -1;
+        }
+        return 0;
+    }
+
+    pos_type seekoff(off_type off, ios::seekdir dir,
+                     ios::openmode /*which*/) override {
+        if (fd < 0) {
+            return pos_type(off_type(-1));
+        }
+        long current = writing ? bufferOffset + (pptr() - pbase())
+                       : bufferOffset + (gptr() - eback());
+        long target = off;
+        if (dir == ios::cur) {
+            target = current + off;
+        } else if (dir == ios::end) {
+            if (writing && !_flush()) {
+                return pos_type(off_type(-1));
+            }
+            struct stat info;
+            if (fstat(fd, &info) != 0) {
+                return pos_type(off_type(-1));
+            }
+            target = info.st_size + off;
+        }
+        if (target < 0) {
+            return pos_type(off_type(-1));
+        }
+        return _seek(target);
+    }
+
+    pos_type seekpos(pos_type pos, ios::openmode which) override {
+        return seekoff(off_type(pos), ios::beg, which);
+    }
+
+ private:
+    int fd;
+    bool writing;
+    bool direct;
+    FileOptions options;
+    char* buffer;
+    long bufferSize;
+    long bufferOffset;  // file offset of buffer[0]
+    char* high;  // end of the bytes written into the buffer so far
+    long extent;  // end of the bytes written to the file so far
+    bool reserved;  // reserve() set the file size ahead of the writes
+
+    //
+    // _seek
+    //
+    // moves to target, inside the buffer when possible
+    pos_type _seek(long target) {
+        if (writing) {
+            high = max(high, pptr());
+            if (target >= bufferOffset
+                && target <= bufferOffset + (high - pbase())) {
+                pbump((int)(target - bufferOffset - (pptr() - pbase())));
+                return pos_type(off_type(target));
+            }
+            if (!_flush()) {
+                return pos_type(off_type(-1));
+            }
+            bufferOffset = target;
+            return pos_type(off_type(target));
+        }
+        if (target >= bufferOffset
+            && target <= bufferOffset + (egptr() - eback())) {
+            setg(eback(), eback() + (target - bufferOffset), egptr());
+        } else {
+            bufferOffset = target;
+            setg(buffer, buffer, buffer);
+        }
+        return pos_type(off_type(target));
+    }
+
+    //
+    // _flush
+    //
+    // writes the buffered bytes and starts a new buffer at the current
+    // position
+    bool _flush() {
+        high = max(high, pptr());
+        long length = high - pbase();
+        if (direct && (bufferOffset % DIRECT_ALIGNMENT != 0
+                       || length % DIRECT_ALIGNMENT != 0)) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+            direct = false;
+        }
+        long done = 0;
+        while (done < length) {
+            ssize_t put = pwrite(fd, pbase() + done, length - done,
+                                 bufferOffset + done);
+            if (put < 0 && errno == EINTR) {
+                continue;
+            }
+            if (put <= 0) {
+                return false;
+            }
+            done += put;
+        }
+        extent = max(extent, bufferOffset + length);
+        bufferOffset += pptr() - pbase();
+        setp(buffer, buffer + bufferSize);
+        high = buffer;
+        return true;
+    }
+};
@@ -54,7 +54,7 @@ hashmap::~hashmap() {
 // This method puts key/value pair in the map.  It checks to see if key is
 // already in map while traversing the list to find the end of it.
 //
-void hashmap::put(int key, int value) {
+void hashmap::put(int key, long value) {
     int magicNumber = hashFunction(key);
     int bucketIndex = magicNumber % nBuckets;
     key_val_pair *front = buckets[bucketIndex];
@@ -88,7 +88,7 @@ void hashmap::put(int key, int value) {
 //
 // This method returns the value associated with key.
 //
-int hashmap::get(int key) const {
+long hashmap::get(int key) const {
     int magicNumber = hashFunction(key);
     int bucketIndex = magicNumber % nBuckets;
     key_val_pair* front = buckets[bucketIndex];
@@ -176,7 +176,7 @@ hashmap::hashmap(const hashmap &myMap) {
     vector<int> keys = myMap.keys();
     for (size_t i=0; i < keys.size(); i++) {
         int key = keys[i];
-        int value = myMap.get(key);
+        long value = myMap.get(key);
         put(key,value);
     }
 
@@ -209,7 +209,7 @@ hashmap& hashmap::operator= (const hashmap &myMap) {
     vector<int> keys = myMap.keys();
     for (size_t i=0; i < keys.size(); i++) {
         int key = keys[i];
-        int value = myMap.get(key);
+        long value = myMap.get(key);
         put(key,value);
     }
 
@@ -226,7 +226,7 @@ ostream &operator<<(ostream &out, hashmap &myMap) {
     vector<int> keys = myMap.keys();
     for (size_t i=0; i < keys.size(); i++) {
         int key = keys[i];
-        int value = myMap.get(key);
+        long value = myMap.get(key);
         out << key << ":" << value;
         if (i < keys.size() - 1) { // no commas after the last one
             out << ", ";
@@ -265,7 +265,7 @@ istream &operator>>(istream &in, hashmap &myMap) {
             //vector<string> kvp;
             size_t pos = nextInput.find(":");
             myMap.put(stoi(nextInput.substr(0, pos)),
-                      stoi(nextInput.substr(pos+1, nextInput.length() - 1)));
+                      stol(nextInput.substr(pos+1, nextInput.length() - 1)));
         }
     }
     return in;
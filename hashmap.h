@@ -3,6 +3,7 @@
 #include <vector>
 #include <ostream>
 #include <istream>
+#include "memstats.h"
 using namespace std;
 
 class hashmap
@@ -11,8 +12,8 @@ public:
     hashmap();
     ~hashmap();
 
-    int get(int key) const;
-    void put(int key, int value);
+    long get(int key) const;
+    void put(int key, long value);
     bool containsKey(int key);
     vector<int> keys() const;
     int size();
@@ -29,8 +30,17 @@ public:
 private:
     struct key_val_pair {
         int key;
-        int value;
+        long value;  // 64 bits so counts of inputs past 2 GB fit
         key_val_pair* next;
+
+        static void* operator new(size_t size) {
+            countAlloc(MEM_HASHMAP_NODE, size);
+            return ::operator new(size);
+        }
+        static void operator delete(void* p, size_t size) {
+            countFree(MEM_HASHMAP_NODE, size);
+            ::operator delete(p);
+        }
     };
 
     typedef key_val_pair** bucketArray; 
@@ -0,0 +1,348 @@
+// File Name : histogram.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : byte histograms over a range of a file, either from a
+//               full scan or from evenly spaced sample slices
+// Data : 04/12/2022
+
+#pragma once
+
+#include <climits>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "util.h"
+
+const int BYTE_VALUES = 256;
+const long DEFAULT_SLICE_SIZE = 64 * 1024;
+const long MIN_THREAD_BYTES = 1024 * 1024;  // smallest share worth a thread
+
+//
+// *This function adds the bytes of data to counts, indexed by unsigned value.
+//
+void countBytes(const char* data, long length, long counts[]) {
+    for (long i = 0; i < length; i++) {
+        counts[(unsigned char)data[i]]++;
+    }
+}
+
+//
+// *This function adds add to total.  Counts are summed two at a time with
+// SSE2 where the compiler has it.
+//
+void mergeCounts(long total[], const long add[]) {
+#if defined(__SSE2__) && LONG_MAX == INT64_MAX
+    for (int i = 0; i < BYTE_VALUES; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(total + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(add + i));
+        _mm_storeu_si128((__m128i*)(total + i), _mm_add_epi64(a, b));
+    }
+#else
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        total[i] += add[i];
+    }
+#endif
+}
+
+//
+// *This function counts the bytes of data into counts.  Four tables are
+// filled in turn so runs of the same byte do not wait on one counter, then
+// folded together.
+//
+void countBytesUnrolled(const char* data, long length, long counts[]) {
+    long tables[4][BYTE_VALUES] = {{0}};
+    const unsigned char* bytes = (const unsigned char*)data;
+    long i = 0;
+    for (; i + 4 <= length; i += 4) {
+        tables[0][bytes[i]]++;
+        tables[1][bytes[i + 1]]++;
+        tables[2][bytes[i + 2]]++;
+        tables[3][bytes[i + 3]]++;
+    }
+    for (; i < length; i++) {
+        tables[0][bytes[i]]++;
+    }
+    for (int t = 0; t < 4; t++) {
+        mergeCounts(counts, tables[t]);
+    }
+}
+
+//
+// *This function sets first[b] to the offset (plus base) of the first b in
+// data for every byte b that counts says is there.  The scan stops once all
+// of them have been seen.
+//
+void firstOccurrences(const char* data, long length, long base,
+                      const long counts[], long first[]) {
+    int missing = 0;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        first[b] = LONG_MAX;
+        missing += (counts[b] > 0);
+    }
+    for (long i = 0; i < length && missing > 0; i++) {
+        unsigned char b = data[i];
+        if (first[b] == LONG_MAX) {
+            first[b] = base + i;
+            missing--;
+        }
+    }
+}
+
+//
+// *This function counts data on up to nThreads threads, each counting its own
+// share into a private table, and merges the tables.  If first is not
+// nullptr it also gets the offset of each byte's first occurrence (LONG_MAX
+// for bytes that never occur).
+//
+void parallelHistogram(const char* data, long length, int nThreads,
+                       long counts[], long first[]) {
+    nThreads = max(1, (int)min((long)nThreads, length / MIN_THREAD_BYTES));
+    long share = (length + nThreads - 1) / nThreads;
+    vector<vector<long> > threadCounts(nThreads, vector<long>(BYTE_VALUES));
+    vector<vector<long> > threadFirst(nThreads, vector<long>(BYTE_VALUES));
+    auto work = [&](int t) {
+        long begin = min(length, t * share);
+        long end = min(length, begin + share);
+        countBytesUnrolled(data + begin, end - begin, threadCounts[t].data());
+        if (first != nullptr) {
+            firstOccurrences(data + begin, end - begin, begin,
+                             threadCounts[t].data(), threadFirst[t].data());
+        }
+    };
+    vector<thread> threads;
+    for (int t = 1; t < nThreads; t++) {
+        threads.push_back(thread(work, t));
+    }
+    work(0);
+    for (thread &worker : threads) {
+        worker.join();
+    }
+    for (int t = 0; t < nThreads; t++) {
+        mergeCounts(counts, threadCounts[t].data());
+    }
+    if (first != nullptr) {
+        for (int b = 0; b < BYTE_VALUES; b++) {
+            first[b] = LONG_MAX;
+            for (int t = 0; t < nThreads && first[b] == LONG_MAX; t++) {
+                first[b] = threadFirst[t][b];
+            }
+        }
+    }
+}
+
+//
+// *This function maps filename and counts it with parallelHistogram.
+// Returns false if the file cannot be opened.
+//
+bool parallelFileHistogram(string filename, int nThreads, long counts[],
+                           long first[]) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+    long length = info.st_size;
+    if (length == 0) {
+        close(fd);
+        parallelHistogram(nullptr, 0, 1, counts, first);
+        return true;
+    }
+    void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, length, MADV_SEQUENTIAL);
+    parallelHistogram((const char*)data, length, nThreads, counts, first);
+    munmap(data, length);
+    return true;
+}
+
+//
+// *This function builds the frequency map of filename like
+// buildFrequencyMap() would, on every core.  Keys are inserted in the order
+// their bytes first appear in the file, which is the order the one byte at a
+// time loop inserts them in, so the map, its header and the tree are the
+// same.  Returns false if the file cannot be opened.
+//
+bool buildParallelFrequencyMap(string filename, int nThreads, hashmap &map) {
+    long counts[BYTE_VALUES] = {0};
+    long first[BYTE_VALUES];
+    if (!parallelFileHistogram(filename, nThreads, counts, first)) {
+        return false;
+    }
+    vector<pair<long, int> > order;
+    for (int b = 0; b < BYTE_VALUES; b++) {
+        if (counts[b] > 0) {
+            order.push_back(make_pair(first[b], b));
+        }
+    }
+    sort(order.begin(), order.end());
+    for (pair<long, int> &entry : order) {
+        map.put((int)(char)entry.second, counts[entry.second]);
+    }
+    return true;
+}
+
+//
+// *This function counts nSlices evenly spaced slices of sliceSize bytes from
+// a buffer that is already in memory.
+//
+void sampleBytes(const char* data, long length, int nSlices, long sliceSize,
+                 long counts[]) {
+    if (nSlices <= 0 || nSlices * sliceSize >= length) {
+        countBytes(data, length, counts);
+        return;
+    }
+    long stride = length / nSlices;
+    for (int i = 0; i < nSlices; i++) {
+        countBytes(data + i * stride, sliceSize, counts);
+    }
+}
+
+//
+// *This function counts every byte of input in [begin, end).
+//
+void fullHistogram(ifstream &input, long begin, long end, long counts[]) {
+    vector<char> buffer(DEFAULT_SLICE_SIZE);
+    input.clear();
+    input.seekg(begin);
+    long remaining = end - begin;
+    while (remaining > 0) {
+        long want = min(remaining, (long)buffer.size());
+        input.read(buffer.data(), want);
+        long got = input.gcount();
+        if (got <= 0) {
+            break;
+        }
+        countBytes(buffer.data(), got, counts);
+        remaining -= got;
+    }
+}
+
+//
+// *This function counts nSlices evenly spaced slices of sliceSize bytes from
+// input in [begin, end).  If the slices would cover the whole range, it
+// falls back to a full scan.
+//
+void sampledHistogram(ifstream &input, long begin, long end, int nSlices,
+                      long sliceSize, long counts[]) {
+    long length = end - begin;
+    if (nSlices <= 0 || nSlices * sliceSize >= length) {
+        fullHistogram(input, begin, end, counts);
+        return;
+    }
+    vector<char> buffer(sliceSize);
+    long stride = length / nSlices;
+    for (int i = 0; i < nSlices; i++) {
+        input.clear();
+        input.seekg(begin + i * stride);
+        input.read(buffer.data(), sliceSize);
+        countBytes(buffer.data(), input.gcount(), counts);
+    }
+}
+
+//
+// *This function builds a frequency map from a histogram.  If smooth is true,
+// every byte value gets a count of at least one so any input stays
+// encodable even if it was never sampled.  PSEUDO_EOF is always included.
+// Keys are inserted in byte order so the same counts give the same tree.
+//
+void histogramFrequencyMap(const long counts[], bool smooth, hashmap &map) {
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        if (counts[i] > 0) {
+            map.put((int)(char)i, counts[i]);
+        } else if (smooth) {
+            map.put((int)(char)i, 1);
+        }
+    }
+    map.put(PSEUDO_EOF, 1);
+}
+
+//
+// *This function builds the frequency map of filename from nSlices evenly
+// spaced slices instead of reading the whole file.
+//
+void buildSampledFrequencyMap(string filename, int nSlices, long sliceSize,
+                              hashmap &map) {
+    ifstream input(filename, ios::binary);
+    input.seekg(0, ios::end);
+    long end = input.tellg();
+    long counts[BYTE_VALUES] = {0};
+    sampledHistogram(input, 0, end, nSlices, sliceSize, counts);
+    histogramFrequencyMap(counts, true, map);
+}
+
+//
+// *This function returns the number of bits needed to code counts with the
+// codes in encodingMap.
+//
+double codedBits(const long counts[], mymap<int, string> &encodingMap) {
+    double bits = 0;
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        if (counts[i] > 0) {
+            bits += (double)counts[i] * encodingMap.get((int)(char)i).length();
+        }
+    }
+    return bits + encodingMap.get(PSEUDO_EOF).length();
+}
+
+//
+// *This function measures how much larger filename gets when its tree is
+// built from a sampled histogram instead of a full scan.  Returns the ratio
+// penalty, e.g. 0.01 means the coded data is 1% larger.
+//
+double sampledPenalty(string filename, int nSlices, long sliceSize) {
+    ifstream input(filename, ios::binary);
+    input.seekg(0, ios::end);
+    long end = input.tellg();
+    long full[BYTE_VALUES] = {0};
+    fullHistogram(input, 0, end, full);
+
+    hashmap fullMap;
+    histogramFrequencyMap(full, false, fullMap);
+    hashmap sampledMap;
+    buildSampledFrequencyMap(filename, nSlices, sliceSize, sampledMap);
+
+    HuffmanNode* fullTree = buildEncodingTree(fullMap);
+    HuffmanNode* sampledTree = buildEncodingTree(sampledMap);
+    mymap<int, string> fullCodes = buildEncodingMap(fullTree);
+    mymap<int, string> sampledCodes = buildEncodingMap(sampledTree);
+    freeTree(fullTree);
+    freeTree(sampledTree);
+    return codedBits(full, sampledCodes) / codedBits(full, fullCodes) - 1;
+}
+
+//
+// *This function compresses filename like compress(), but builds the tree
+// from a sampled histogram so encoding can start after reading only the
+// slices.  The output is a normal .huf file that decompress() can read.
+// Returns its size in bytes.
+//
+long compressSampled(string filename, int nSlices, long sliceSize) {
+    hashmap frequencyMap;
+    buildSampledFrequencyMap(filename, nSlices, sliceSize, frequencyMap);
+    HuffmanNode* tree = buildEncodingTree(frequencyMap);
+    mymap<int, string> encodingMap = buildEncodingMap(tree);
+    ofbitstream output(filename + ".huf");
+    output << frequencyMap;
+    ifstream input(filename);
+    freeTree(tree);
+    stringstream header;
+    header << frequencyMap;
+    long bits = encodeStream(input, encodingMap, output);
+    return header.str().length() + (bits + 7) / 8;
+}
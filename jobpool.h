@@ -0,0 +1,477 @@
+// File Name : jobpool.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : a process wide pool of worker threads that compresses and
+//               decompresses buffers and files in the background, handing
+//               results back through futures or callbacks
+// Data : 04/12/2022
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "blockfile.h"
+
+using namespace std;
+
+enum JobType {
+    JOB_COMPRESS_BUFFER,  // input is data, result is a block file image
+    JOB_DECOMPRESS_BUFFER,  // input is a block file image, result is data
+    JOB_COMPRESS_FILE,  // input is a filename, result is the .hufb name
+    JOB_DECOMPRESS_FILE,  // input is a .hufb name, result is the output name
+    JOB_TASK  // runs a JobTask, result is what it returns
+};
+
+const int PRIORITY_LOW = 0;
+const int PRIORITY_NORMAL = 1;
+const int PRIORITY_HIGH = 2;
+
+typedef function<void(const string &result, exception_ptr error)> JobCallback;
+typedef function<string(BlockJob &scratch, const atomic<bool>* cancel)> JobTask;
+
+//
+// *This function codes data as an in memory block file: the header followed
+// by one record per block, without an index, so the image can also be
+// written out and read by decompressBlocks.  job is scratch space whose
+// buffers are kept between calls.  Throws if cancel becomes true between
+// blocks.
+//
+string compressBuffer(const string &data, BlockOptions &options,
+                      BlockJob &job, const atomic<bool>* cancel) {
+    string out(BLOCKFILE_MAGIC, 4);
+    out += (char)BLOCKFILE_VERSION;
+    out += (char)(options.nStreams > 1 ? BLOCKFILE_STREAMS : 0);
+    putU16(out, options.nStreams);
+    putU32(out, options.blockSize);
+    for (long begin = 0; begin < (long)data.size();
+         begin += options.blockSize) {
+        if (cancel != nullptr && *cancel) {
+            throw runtime_error("Job cancelled!");
+        }
+        job.rawLength = min(options.blockSize, (long)data.size() - begin);
+        job.input.assign(data.begin() + begin,
+                         data.begin() + begin + job.rawLength);
+        codeBlock(job, options, nullptr);
+        out += (char)job.type;
+        putU32(out, job.rawLength);
+        if (job.type == BLOCK_RAW) {
+            putU32(out, job.rawLength);
+            out.append(job.input.data(), job.rawLength);
+        } else {
+            putU32(out, job.output.size());
+            out += job.output;
+        }
+    }
+    return out;
+}
+
+//
+// *This function reverses compressBuffer.  It reads the records of any
+// block file image: in order without an index, and in index order with
+// one, so appended images, which hold dead old indexes between their
+// blocks, work too.
+//
+string decompressBuffer(const string &image, BlockJob &job,
+                        const atomic<bool>* cancel) {
+    if (image.size() < (size_t)BLOCKFILE_HEADER_SIZE
+        || memcmp(image.data(), BLOCKFILE_MAGIC, 4) != 0) {
+        throw runtime_error("Not a block file!");
+    }
+    int nStreams = blockStreams(image.data());
+    long end = image.size();
+    vector<SeekBlock> index;
+    bool indexed = (image[5] & BLOCKFILE_INDEXED) != 0;
+    if (indexed) {
+        if (end < BLOCKFILE_HEADER_SIZE + BLOCKFILE_TRAILER_SIZE) {
+            throw runtime_error("Block file index is missing!");
+        }
+        end -= BLOCKFILE_TRAILER_SIZE;
+        const char* trailer = image.data() + end;
+        uint64_t indexOffset = getU64(trailer);
+        if (memcmp(trailer + 16, BLOCKFILE_INDEX_MAGIC, 4) != 0
+            || indexOffset < (uint64_t)BLOCKFILE_HEADER_SIZE
+            || indexOffset > (uint64_t)end
+            || !parseIndexEntries(image.data() + indexOffset,
+                                  end - indexOffset, getU32(trailer + 8),
+                                  indexOffset, index)) {
+            throw runtime_error("Bad block file index!");
+        }
+        end = indexOffset;
+    }
+    string out;
+    long pos = BLOCKFILE_HEADER_SIZE;
+    for (long b = 0; indexed ? b < (long)index.size()
+                             : pos + BLOCK_RECORD_SIZE <= end; b++) {
+        if (cancel != nullptr && *cancel) {
+            throw runtime_error("Job cancelled!");
+        }
+        if (indexed) {
+            pos = index[b].recordOffset;
+        }
+        job.type = image[pos];
+        job.rawLength = getU32(image.data() + pos + 1);
+        long payloadLength = getU32(image.data() + pos + 5);
+        checkBlockRecord(job.type, job.rawLength, payloadLength);
+        pos += BLOCK_RECORD_SIZE;
+        if (pos + payloadLength > end) {
+            throw runtime_error("Truncated block file!");
+        }
+        if (job.type == BLOCK_RAW) {
+            out.append(image, pos, job.rawLength);
+        } else {
+            job.input.assign(image.begin() + pos,
+                             image.begin() + pos + payloadLength);
+            decodeBlockJob(job, nullptr, nStreams);
+            out += job.output;
+        }
+        pos += payloadLength;
+    }
+    return out;
+}
+
+//
+// jobhandle:
+// What submit returns: the future result of a job and a way to cancel it.
+// Copies refer to the same job.
+//
+class jobhandle {
+ public:
+    jobhandle() {
+    }
+
+    jobhandle(shared_future<string> result, shared_ptr<atomic<bool> > cancelled)
+        : result(result), cancelled(cancelled) {
+    }
+
+    //
+    // get:
+    // Waits for the job and returns its result, or rethrows its error.
+    //
+    string get() {
+        return result.get();
+    }
+
+    //
+    // ready:
+    // Returns true once the job has finished, failed or been cancelled.
+    //
+    bool ready() {
+        return result.wait_for(chrono::seconds(0)) == future_status::ready;
+    }
+
+    //
+    // cancel:
+    // Asks the job to stop.  A job that has not started never runs; buffer
+    // jobs that are running stop at the next block.  Either way get()
+    // throws.  File jobs that are running finish normally.
+    //
+    void cancel() {
+        *cancelled = true;
+    }
+
+ private:
+    shared_future<string> result;
+    shared_ptr<atomic<bool> > cancelled;
+};
+
+//
+// workerpool:
+// A fixed set of worker threads, one per core, taking jobs from a priority
+// queue.  Higher priorities run first and jobs of equal priority run in the
+// order they were submitted.  Each job runs on one worker from start to
+// end, so many small jobs never start more threads than there are cores,
+// and every worker keeps its block buffers between jobs.  Block options
+// come from the pool, with the coder run serially on the worker.
+//
+class workerpool {
+ public:
+    workerpool(int nWorkers, BlockOptions options) {
+        this->options = options;
+        this->options.queueDepth = 0;
+        this->options.cache = nullptr;
+        this->options.verify = nullptr;
+        stopping = false;
+        nextSequence = 0;
+        completed = 0;
+        failed = 0;
+        cancelledJobs = 0;
+        for (int i = 0; i < max(1, nWorkers); i++) {
+            workers.push_back(thread(&workerpool::_work, this));
+        }
+    }
+
+    //
+    // destructor:
+    // Cancels the jobs still queued and waits for the running ones.
+    //
+    ~workerpool() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (thread &worker : workers) {
+            worker.join();
+        }
+        while (!jobs.empty()) {
+            _cancel(*jobs.top());
+            jobs.pop();
+        }
+    }
+
+    //
+    // shared:
+    // Returns the pool for the whole process, started on first use with
+    // one worker per core and the default block options.
+    //
+    static workerpool& shared() {
+        static workerpool pool(thread::hardware_concurrency(),
+                               defaultBlockOptions());
+        return pool;
+    }
+
+    //
+    // submit:
+    // Queues a job and returns its handle.  If callback is set it is called
+    // on the worker with the result, or with the error when the job fails
+    // or is cancelled, before the future becomes ready.  If the callback
+    // throws, the job fails with that exception instead.
+    //
+    jobhandle submit(JobType type, string input, int priority,
+                     JobCallback callback = nullptr) {
+        return _submit(type, move(input), nullptr, priority, callback);
+    }
+
+    //
+    // submitTask:
+    // Queues work that is not one of the job types, such as a request that
+    // reads and writes file descriptors.  task runs on a worker with that
+    // worker's scratch block buffers.
+    //
+    jobhandle submitTask(JobTask task, int priority,
+                         JobCallback callback = nullptr) {
+        return _submit(JOB_TASK, "", task, priority, callback);
+    }
+
+    int size() {
+        return workers.size();
+    }
+
+    long completedJobs() {
+        return completed;
+    }
+
+    long failedJobs() {
+        return failed;
+    }
+
+    long cancelledCount() {
+        return cancelledJobs;
+    }
+
+ private:
+    struct Job {
+        JobType type;
+        string input;
+        int priority;
+        long sequence;
+        JobCallback callback;
+        JobTask task;  // only for JOB_TASK
+        promise<string> done;
+        shared_ptr<atomic<bool> > cancelled;
+    };
+
+    // orders the queue by priority, then by submission
+    struct jobOrder {
+        bool operator()(const shared_ptr<Job> &a,
+                        const shared_ptr<Job> &b) const {
+            if (a->priority != b->priority) {
+                return a->priority < b->priority;
+            }
+            return a->sequence > b->sequence;
+        }
+    };
+
+    BlockOptions options;
+    vector<thread> workers;
+    priority_queue<shared_ptr<Job>, vector<shared_ptr<Job> >, jobOrder> jobs;
+    mutex m;
+    condition_variable wakeUp;
+    bool stopping;
+    long nextSequence;
+    atomic<long> completed;
+    atomic<long> failed;
+    atomic<long> cancelledJobs;
+
+    //
+    // _submit
+    //
+    // queues a job of any type
+    jobhandle _submit(JobType type, string input, JobTask task, int priority,
+                      JobCallback callback) {
+        shared_ptr<Job> job = make_shared<Job>();
+        job->type = type;
+        job->input = move(input);
+        job->task = task;
+        job->priority = priority;
+        job->callback = callback;
+        job->cancelled = make_shared<atomic<bool> >(false);
+        jobhandle handle(job->done.get_future().share(), job->cancelled);
+        {
+            lock_guard<mutex> lock(m);
+            if (stopping) {
+                throw runtime_error("Worker pool is stopping!");
+            }
+            job->sequence = nextSequence++;
+            jobs.push(job);
+        }
+        wakeUp.notify_one();
+        return handle;
+    }
+
+    //
+    // _work
+    //
+    // the loop each worker runs until the pool stops
+    void _work() {
+        BlockJob scratch;  // kept for every job this worker runs
+        while (true) {
+            shared_ptr<Job> job;
+            {
+                unique_lock<mutex> lock(m);
+                wakeUp.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    return;
+                }
+                job = jobs.top();
+                jobs.pop();
+            }
+            if (*job->cancelled) {
+                _cancel(*job);
+                continue;
+            }
+            _run(*job, scratch);
+        }
+    }
+
+    //
+    // _run
+    //
+    // runs one job and hands back its result or error
+    void _run(Job &job, BlockJob &scratch) {
+        string result;
+        exception_ptr error;
+        try {
+            result = _code(job, scratch);
+        } catch (...) {
+            error = current_exception();
+        }
+        if (error && *job.cancelled) {
+            _cancel(job);
+            return;
+        }
+        exception_ptr callbackError = _callback(job, result, error);
+        if (callbackError) {
+            error = callbackError;
+        }
+        if (error) {
+            failed++;
+            job.done.set_exception(error);
+        } else {
+            completed++;
+            job.done.set_value(move(result));
+        }
+    }
+
+    //
+    // _code
+    //
+    // does the work of one job
+    string _code(Job &job, BlockJob &scratch) {
+        PipelineStats stats = emptyPipelineStats();
+        BlockOptions local = options;
+        switch (job.type) {
+        case JOB_COMPRESS_BUFFER:
+            return compressBuffer(job.input, local, scratch,
+                                  job.cancelled.get());
+        case JOB_DECOMPRESS_BUFFER:
+            return decompressBuffer(job.input, scratch, job.cancelled.get());
+        case JOB_COMPRESS_FILE:
+            compressBlocks(job.input, local, stats);
+            return job.input + ".hufb";
+        case JOB_DECOMPRESS_FILE:
+            decompressBlocks(job.input, local, stats);
+            return uncompressedName(job.input, ".hufb");
+        case JOB_TASK:
+            return job.task(scratch, job.cancelled.get());
+        }
+        throw invalid_argument("Bad job type!");
+    }
+
+    //
+    // _cancel
+    //
+    // fails a job that was cancelled
+    void _cancel(Job &job) {
+        cancelledJobs++;
+        exception_ptr error = make_exception_ptr(
+            runtime_error("Job cancelled!"));
+        _callback(job, "", error);
+        job.done.set_exception(error);
+    }
+
+    //
+    // _callback
+    //
+    // calls the job's callback, if any, and returns what it threw so an
+    // exception never escapes the worker and the future is always set
+    exception_ptr _callback(Job &job, const string &result,
+                            exception_ptr error) {
+        if (!job.callback) {
+            return nullptr;
+        }
+        try {
+            job.callback(result, error);
+        } catch (...) {
+            return current_exception();
+        }
+        return nullptr;
+    }
+};
+
+//
+// *These functions queue work on the shared pool and return right away.
+//
+jobhandle compressAsync(const string &data, int priority = PRIORITY_NORMAL,
+                        JobCallback callback = nullptr) {
+    return workerpool::shared().submit(JOB_COMPRESS_BUFFER, data, priority,
+                                       callback);
+}
+
+jobhandle decompressAsync(const string &image, int priority = PRIORITY_NORMAL,
+                          JobCallback callback = nullptr) {
+    return workerpool::shared().submit(JOB_DECOMPRESS_BUFFER, image, priority,
+                                       callback);
+}
+
+jobhandle compressFileAsync(string filename, int priority = PRIORITY_NORMAL,
+                            JobCallback callback = nullptr) {
+    return workerpool::shared().submit(JOB_COMPRESS_FILE, filename, priority,
+                                       callback);
+}
+
+jobhandle decompressFileAsync(string filename, int priority = PRIORITY_NORMAL,
+                              JobCallback callback = nullptr) {
+    return workerpool::shared().submit(JOB_DECOMPRESS_FILE, filename,
+                                       priority, callback);
+}
@@ -20,6 +20,14 @@
 #include <math.h>
 #include "bitstream.h"
 #include "util.h"
+#include "codebook.h"
+#include "histogram.h"
+#include "blockfile.h"
+#include "archive.h"
+#include "seekreader.h"
+#include "benchmark.h"
+#include "analyze.h"
+#include "verify.h"
 
 using namespace std;
 
@@ -36,6 +44,16 @@ void printMap(hashmap &map);
 void printTree(HuffmanNode* node, string str);
 void printTextFile(string filename);
 void printBinaryFile(string filename);
+void doTrain();
+void doCached();
+void doSampled();
+void doBlocks(string choice);
+void doArchive(string choice);
+void doReadRange();
+void doMemory();
+void doAnalyze();
+void doBenchmark(string choice);
+void doDaemon(string choice);
 
 int main() {
     
@@ -49,25 +67,59 @@ int main() {
     string choice = "weeeee";
     while (choice != "Q") {
         choice = menu();
-        if (is123456(choice)){
-            do123456(choice, filename, isFile, frequencyMap,
-                    encodingTree, encodingMap);
-        } else if (choice == "C") {
-            cout << "Enter filename: ";
-            cin >> filename;
-            compress(filename);
-        } else if (choice == "D") {
-            cout << "Enter filename: ";
-            cin >> filename;
-            decompress(filename);
-        } else if (choice == "B") {
-            cout << "Enter filename: ";
-            cin >> filename;
-            printBinaryFile(filename);
-        } else if (choice == "T") {
-            cout << "Enter filename: ";
-            cin >> filename;
-            printTextFile(filename);
+        // a bad file or bad input fails that command, not the program
+        try {
+            if (is123456(choice)){
+                do123456(choice, filename, isFile, frequencyMap,
+                        encodingTree, encodingMap);
+            } else if (choice == "C") {
+                cout << "Enter filename: ";
+                cin >> filename;
+                compress(filename);
+            } else if (choice == "D") {
+                cout << "Enter filename: ";
+                cin >> filename;
+                decompress(filename);
+            } else if (choice == "K") {
+                doTrain();
+            } else if (choice == "P") {
+                cout << "Enter filename: ";
+                cin >> filename;
+                cout << "Enter codebook id: ";
+                int id;
+                cin >> id;
+                compressWithCodebook(filename, id);
+            } else if (choice == "CC") {
+                doCached();
+            } else if (choice == "S") {
+                doSampled();
+            } else if (choice == "BC" || choice == "BD" || choice == "BA") {
+                doBlocks(choice);
+            } else if (choice == "AC" || choice == "AL" || choice == "AX") {
+                doArchive(choice);
+            } else if (choice == "R") {
+                doReadRange();
+            } else if (choice == "M") {
+                doMemory();
+            } else if (choice == "AN") {
+                doAnalyze();
+            } else if (choice == "DS" || choice == "DC" || choice == "DL") {
+                doDaemon(choice);
+            } else if (choice == "IB" || choice == "EB" || choice == "HB"
+                       || choice == "JB" || choice == "MB"
+                       || choice == "SB" || choice == "TB") {
+                doBenchmark(choice);
+            } else if (choice == "B") {
+                cout << "Enter filename: ";
+                cin >> filename;
+                printBinaryFile(filename);
+            } else if (choice == "T") {
+                cout << "Enter filename: ";
+                cin >> filename;
+                printTextFile(filename);
+            }
+        } catch (exception &e) {
+            cout << e.what() << endl;
         }
     }
 
@@ -89,6 +141,29 @@ string menu() {
     cout << endl;
     cout << "C.  Compress file" << endl;
     cout << "D.  Decompress file" << endl;
+    cout << "K.  Train codebook" << endl;
+    cout << "P.  Compress file with codebook" << endl;
+    cout << "CC. Compress files with codebook cache" << endl;
+    cout << "S.  Compress file from sampled histogram" << endl;
+    cout << "BC. Compress file in blocks" << endl;
+    cout << "BD. Decompress block file" << endl;
+    cout << "BA. Append file to block file" << endl;
+    cout << "AC. Create archive from directory" << endl;
+    cout << "AL. List archive" << endl;
+    cout << "AX. Extract file from archive" << endl;
+    cout << "R.  Read range from block file" << endl;
+    cout << "M.  Memory use of compress and decompress" << endl;
+    cout << "AN. Analyze files without compressing" << endl;
+    cout << "DS. Start compression daemon" << endl;
+    cout << "DC. Send request to daemon" << endl;
+    cout << "DL. Load test daemon" << endl;
+    cout << "IB. Benchmark file I/O" << endl;
+    cout << "EB. Benchmark pair encoding" << endl;
+    cout << "HB. Benchmark histogram" << endl;
+    cout << "JB. Benchmark worker pool" << endl;
+    cout << "MB. Benchmark mymap, btreemap and std::map" << endl;
+    cout << "SB. Benchmark snapshot map readers" << endl;
+    cout << "TB. Benchmark hashmap, swissmap and std::unordered_map" << endl;
     cout << endl;
     cout << "B.  Binary file viewer" << endl;
     cout << "T.  Text file viewer" << endl;
@@ -181,13 +256,14 @@ void do123456(string choice, string &filename, bool &isFile,
         // note: << is overloaded for the hashmap class.  super nice!
         ss << frequencyMap;
         output << frequencyMap;  // add the frequency map to the file
-        int size = 0;
+        long size = 0;
         string codeStr = encode(input, encodingMap, output, size, true);
         // count bytes in frequency map header
         size = ss.str().length() + ceil((double)size / 8);
         cout << "Compressed file size: " << size << endl;
         cout << codeStr << endl;
         cout << endl;
+        releaseString(codeStr);
         output.close();  // must close file so autograder can open for testing
     // Decode text
     } else if (choice == "5") {
@@ -219,6 +295,7 @@ void do123456(string choice, string &filename, bool &isFile,
         string decodeStr  = decode(input, encodingTree, output);
         cout << decodeStr << endl;
         cout << endl;
+        releaseString(decodeStr);
         output.close(); // must close file so autograder can open for testing
     // Free the Encoding Tree
     } else if (choice == "6") {
@@ -227,6 +304,348 @@ void do123456(string choice, string &filename, bool &isFile,
     }
 }
 
+//
+// doTrain
+// Builds a shared codebook from sample files and saves it by id.
+//
+void doTrain() {
+    int id;
+    int nFiles;
+    cout << "Enter codebook id: ";
+    cin >> id;
+    if (id < TRAINED_FIRST_ID || id > TRAINED_LAST_ID) {
+        // higher ids belong to the codebook cache
+        cout << "Codebook ids must be " << TRAINED_FIRST_ID << " to "
+             << TRAINED_LAST_ID << "!" << endl;
+        return;
+    }
+    cout << "Enter number of sample files: ";
+    cin >> nFiles;
+    vector<string> samples;
+    for (int i = 0; i < nFiles; i++) {
+        string sample;
+        cout << "Enter sample file: ";
+        cin >> sample;
+        samples.push_back(sample);
+    }
+    int counts[CODEBOOK_SYMBOLS];
+    trainCodebook(samples, counts);
+    saveCodebook(id, counts);
+    cout << "Saved codebook_" << id << ".cb and codebook_" << id << ".h"
+         << endl;
+}
+
+//
+// doCached
+// Compresses files through the codebook cache and prints its hit rate.
+//
+void doCached() {
+    int nFiles;
+    cout << "Enter number of files: ";
+    cin >> nFiles;
+    codebookcache cache(DEFAULT_REUSE_THRESHOLD);
+    for (int i = 0; i < nFiles; i++) {
+        string filename;
+        cout << "Enter filename: ";
+        cin >> filename;
+        int id = compressCached(filename, cache);
+        if (id >= 0) {
+            cout << filename << ": codebook " << id << endl;
+        } else {
+            cout << filename << ": own tree" << endl;
+        }
+    }
+    // the files that missed become one entry
+    cache.commit();
+    cache.save();
+    cache.printStats();
+}
+
+//
+// doSampled
+// Compresses a file with a tree built from sampled slices and optionally
+// reports the size penalty against a full scan.
+//
+void doSampled() {
+    string filename;
+    int nSlices;
+    cout << "Enter filename: ";
+    cin >> filename;
+    cout << "Enter number of slices: ";
+    cin >> nSlices;
+    compressSampled(filename, nSlices, DEFAULT_SLICE_SIZE);
+    cout << "Measure penalty against full scan? [Y/N] ";
+    string yORn;
+    cin >> yORn;
+    if (yORn == "Y") {
+        double penalty = sampledPenalty(filename, nSlices, DEFAULT_SLICE_SIZE);
+        cout << "Ratio penalty: " << penalty * 100 << "%" << endl;
+    }
+}
+
+//
+// doBlocks
+// Compresses (BC), decompresses (BD) or appends a file to (BA) a block
+// file.
+//
+void doBlocks(string choice) {
+    string filename;
+    cout << "Enter filename: ";
+    cin >> filename;
+    BlockOptions options = defaultBlockOptions();
+    PipelineStats stats = emptyPipelineStats();
+    cout << "Enter queue depth (0 for serial): ";
+    cin >> options.queueDepth;
+    if (choice == "BD") {
+        long size = decompressBlocks(filename, options, stats);
+        cout << "Decompressed file size: " << size << endl;
+        printPipelineStats(stats);
+        return;
+    }
+    cout << "Verify blocks as they are written? [Y/N] ";
+    string verify;
+    cin >> verify;
+    if (choice == "BA") {
+        string appended;
+        cout << "Enter file to append: ";
+        cin >> appended;
+        blockverifier verifier(workerpool::shared());
+        if (verify == "Y") {
+            options.verify = &verifier;
+        }
+        long size = appendBlocks(filename, appended, options, stats);
+        cout << "Block file size: " << size << endl;
+        if (verify == "Y") {
+            cout << "Verified " << verifier.verifiedCount() << " coded blocks"
+                 << endl;
+        }
+        printPipelineStats(stats);
+        return;
+    }
+    cout << "Enter block size in KB: ";
+    cin >> options.blockSize;
+    options.blockSize *= 1024;
+    cout << "Enter number of sample slices per block (0 for full scan): ";
+    cin >> options.sampleSlices;
+    cout << "Enter io_uring reads in flight (0 for pread): ";
+    cin >> options.uringDepth;
+    cout << "Enter interleaved streams per block (1, 4 or 8): ";
+    cin >> options.nStreams;
+    cout << "Use codebook cache? [Y/N] ";
+    string yORn;
+    cin >> yORn;
+    codebookcache cache(DEFAULT_REUSE_THRESHOLD);
+    if (yORn == "Y") {
+        options.cache = &cache;
+    }
+    blockverifier verifier(workerpool::shared());
+    if (verify == "Y") {
+        options.verify = &verifier;
+    }
+    long size = compressBlocks(filename, options, stats);
+    cout << "Compressed file size: " << size << endl;
+    if (verify == "Y") {
+        cout << "Verified " << verifier.verifiedCount() << " coded blocks"
+             << endl;
+    }
+    printPipelineStats(stats);
+    if (options.cache != nullptr) {
+        cache.save();
+        cache.printStats();
+    }
+}
+
+//
+// doArchive
+// Creates (AC), lists (AL) or extracts one member of (AX) an archive.
+//
+void doArchive(string choice) {
+    string archiveName;
+    cout << "Enter archive name: ";
+    cin >> archiveName;
+    if (choice == "AC") {
+        string dir;
+        cout << "Enter directory: ";
+        cin >> dir;
+        long size = createArchive(archiveName, dir, defaultArchiveOptions());
+        cout << "Archive size: " << size << endl;
+    } else if (choice == "AL") {
+        for (ArchiveEntry &entry : listArchive(archiveName)) {
+            cout << entry.name << '\t' << entry.size << '\t'
+                 << entry.compressedSize << endl;
+        }
+    } else {
+        string member;
+        string outName;
+        cout << "Enter member name: ";
+        cin >> member;
+        cout << "Enter output file: ";
+        cin >> outName;
+        long size = extractMember(archiveName, member, outName);
+        cout << "Extracted " << size << " bytes" << endl;
+    }
+}
+
+//
+// doReadRange
+// Reads part of a block file without decompressing the rest of it.
+//
+void doReadRange() {
+    string filename;
+    long offset;
+    long length;
+    cout << "Enter filename: ";
+    cin >> filename;
+    cout << "Enter offset: ";
+    cin >> offset;
+    cout << "Enter length: ";
+    cin >> length;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string data = readRange(filename, offset, length);
+    double micros = secondsSince(start) * 1e6;
+    cout << data << endl;
+    cout << "Read " << data.size() << " bytes in " << micros << "us" << endl;
+}
+
+//
+// doMemory
+// Compresses and decompresses a file, printing the time, allocations and
+// peak RSS of each step.
+//
+void doMemory() {
+    string filename;
+    cout << "Enter filename: ";
+    cin >> filename;
+    for (int step = 0; step < 2; step++) {
+        resetPeakRss();
+        MemUsage before = processMemUsage();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (step == 0) {
+            compress(filename);
+        } else {
+            decompress(filename + ".huf");
+        }
+        double seconds = secondsSince(start);
+        MemUsage usage = memDelta(before, processMemUsage());
+        string name = (step == 0) ? "Compress" : "Decompress";
+        cout << name << ": " << seconds << "s, peak RSS: " << peakRssKB()
+             << " KB" << endl;
+        printMemUsage(name, usage);
+    }
+}
+
+//
+// doAnalyze
+// Predicts the compressed size of every file in a directory with each
+// engine from their histograms.
+//
+void doAnalyze() {
+    string path;
+    long prefix;
+    int nThreads;
+    cout << "Enter file or directory: ";
+    cin >> path;
+    cout << "Enter bytes to analyze per file (0 for whole files): ";
+    cin >> prefix;
+    cout << "Enter number of threads: ";
+    cin >> nThreads;
+    analyze(path, prefix, nThreads);
+}
+
+//
+// doDaemon
+// Runs the compression daemon (DS), sends it one request (DC) or load tests
+// it (DL).
+//
+void doDaemon(string choice) {
+    string path;
+    cout << "Enter socket path (. for " << DEFAULT_SOCKET << "): ";
+    cin >> path;
+    if (path == ".") {
+        path = DEFAULT_SOCKET;
+    }
+    if (choice == "DS") {
+        compressiondaemon daemon(path);
+        cout << "Listening on " << path << endl;
+        daemon.run();
+        cout << daemon.stats() << endl;
+    } else if (choice == "DC") {
+        string request;
+        cout << "Enter request (C, D, S for stats, Q to stop daemon): ";
+        cin >> request;
+        if (request == "C" || request == "D") {
+            string inName;
+            string outName;
+            cout << "Enter input file: ";
+            cin >> inName;
+            cout << "Enter output file: ";
+            cin >> outName;
+            long size = daemonFile(path, request == "C" ? DAEMON_COMPRESS
+                                   : DAEMON_DECOMPRESS, inName, outName);
+            cout << "Wrote " << size << " bytes to " << outName << endl;
+        } else if (request == "S" || request == "Q") {
+            string text;
+            daemonRequest(path, request == "S" ? DAEMON_STATS
+                          : DAEMON_SHUTDOWN, -1, -1, PRIORITY_NORMAL, text);
+            cout << text << endl;
+        } else {
+            cout << "Unknown request " << request << endl;
+        }
+    } else {
+        string filename;
+        int nClients;
+        int nRequests;
+        cout << "Enter filename: ";
+        cin >> filename;
+        cout << "Enter number of clients: ";
+        cin >> nClients;
+        cout << "Enter requests per client: ";
+        cin >> nRequests;
+        benchDaemon(path, filename, nClients, nRequests);
+    }
+}
+
+//
+// doBenchmark
+// Runs one of the benchmarks in benchmark.h on a file, or the map
+// benchmarks (MB, SB, TB) on generated keys.
+//
+void doBenchmark(string choice) {
+    if (choice == "MB" || choice == "TB") {
+        long maxKeys;
+        cout << "Enter largest number of keys: ";
+        cin >> maxKeys;
+        if (choice == "MB") {
+            benchMaps(maxKeys);
+        } else {
+            benchHashMaps(maxKeys);
+        }
+        return;
+    }
+    if (choice == "SB") {
+        int nKeys;
+        int nThreads;
+        cout << "Enter number of keys: ";
+        cin >> nKeys;
+        cout << "Enter number of reader threads: ";
+        cin >> nThreads;
+        benchSnapshot(nKeys, nThreads);
+        return;
+    }
+    string filename;
+    cout << "Enter filename: ";
+    cin >> filename;
+    if (choice == "IB") {
+        benchIo(filename);
+    } else if (choice == "EB") {
+        benchEncode(filename);
+    } else if (choice == "HB") {
+        benchHistogram(filename);
+    } else if (choice == "JB") {
+        benchJobs(filename);
+    }
+}
+
 //
 // printChar
 // This function takes in an integer value and prints the ASCII character with
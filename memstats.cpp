@@ -0,0 +1,160 @@
+// File Name : memstats.cpp
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : allocation counters and peak RSS per stage, cheap enough
+//               to leave on for production sized inputs
+// Data : 04/12/2022
+
+#include "memstats.h"
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <string>
+using namespace std;
+
+static const char* MEM_CATEGORY_NAMES[MEM_CATEGORIES] = {
+    "HuffmanNode", "hashmap node", "mymap NODE", "code string", "block buffer",
+    "btreemap node"
+};
+
+static atomic<long> processAllocs[MEM_CATEGORIES];
+static atomic<long> processBytes[MEM_CATEGORIES];
+static atomic<long> processFrees[MEM_CATEGORIES];
+static atomic<long> processFreedBytes[MEM_CATEGORIES];
+static thread_local MemUsage threadUsage = MemUsage();
+
+//
+// *This function counts one allocation of bytes in category.
+//
+void countAlloc(int category, long bytes) {
+    threadUsage.allocs[category]++;
+    threadUsage.bytes[category] += bytes;
+    processAllocs[category].fetch_add(1, memory_order_relaxed);
+    processBytes[category].fetch_add(bytes, memory_order_relaxed);
+}
+
+//
+// *This function counts one free of bytes in category.
+//
+void countFree(int category, long bytes) {
+    threadUsage.frees[category]++;
+    threadUsage.freedBytes[category] += bytes;
+    processFrees[category].fetch_add(1, memory_order_relaxed);
+    processFreedBytes[category].fetch_add(bytes, memory_order_relaxed);
+}
+
+//
+// *This function counts a buffer reallocation.  Nothing is counted if the
+// capacity did not change, so it can be called after every append.  A new
+// capacity of 0 counts the final free of the buffer.
+//
+void countGrowth(int category, long oldCapacity, long newCapacity) {
+    if (newCapacity == oldCapacity) {
+        return;
+    }
+    if (oldCapacity > 0) {
+        countFree(category, oldCapacity);
+    }
+    if (newCapacity > 0) {
+        countAlloc(category, newCapacity);
+    }
+}
+
+//
+// *This function returns the counters of the calling thread.
+//
+MemUsage threadMemUsage() {
+    return threadUsage;
+}
+
+//
+// *This function returns the counters of every thread together.
+//
+MemUsage processMemUsage() {
+    MemUsage usage = MemUsage();
+    for (int i = 0; i < MEM_CATEGORIES; i++) {
+        usage.allocs[i] = processAllocs[i].load(memory_order_relaxed);
+        usage.bytes[i] = processBytes[i].load(memory_order_relaxed);
+        usage.frees[i] = processFrees[i].load(memory_order_relaxed);
+        usage.freedBytes[i] = processFreedBytes[i].load(memory_order_relaxed);
+    }
+    return usage;
+}
+
+//
+// *This function returns the counters that changed between two snapshots.
+//
+MemUsage memDelta(const MemUsage &before, const MemUsage &after) {
+    MemUsage delta = MemUsage();
+    for (int i = 0; i < MEM_CATEGORIES; i++) {
+        delta.allocs[i] = after.allocs[i] - before.allocs[i];
+        delta.bytes[i] = after.bytes[i] - before.bytes[i];
+        delta.frees[i] = after.frees[i] - before.frees[i];
+        delta.freedBytes[i] = after.freedBytes[i] - before.freedBytes[i];
+    }
+    return delta;
+}
+
+//
+// *This function adds the counters of usage to total.
+//
+void addMemUsage(MemUsage &total, const MemUsage &usage) {
+    for (int i = 0; i < MEM_CATEGORIES; i++) {
+        total.allocs[i] += usage.allocs[i];
+        total.bytes[i] += usage.bytes[i];
+        total.frees[i] += usage.frees[i];
+        total.freedBytes[i] += usage.freedBytes[i];
+    }
+}
+
+//
+// reads a "Name:   1234 kB" line from /proc/self/status
+//
+static long _statusKB(string name) {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, name.size(), name) == 0) {
+            return stol(line.substr(name.size()));
+        }
+    }
+    return 0;
+}
+
+long currentRssKB() {
+    return _statusKB("VmRSS:");
+}
+
+long peakRssKB() {
+    return _statusKB("VmHWM:");
+}
+
+//
+// *This function resets the kernel's peak RSS to the current RSS by writing
+// 5 to /proc/self/clear_refs, so the next peakRssKB() is the peak of the
+// stage that follows.
+//
+void resetPeakRss() {
+    ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5" << endl;
+}
+
+//
+// *This function prints the counters of one stage.
+//
+void printMemUsage(string stage, const MemUsage &usage) {
+    bool any = false;
+    for (int i = 0; i < MEM_CATEGORIES; i++) {
+        if (usage.allocs[i] == 0 && usage.frees[i] == 0) {
+            continue;
+        }
+        any = true;
+        cout << stage << " " << MEM_CATEGORY_NAMES[i] << ": " << usage.allocs[i]
+             << " allocs, " << usage.bytes[i] << " bytes, " << usage.frees[i]
+             << " frees, " << usage.freedBytes[i] << " bytes freed" << endl;
+    }
+    if (!any) {
+        cout << stage << " allocated nothing" << endl;
+    }
+}
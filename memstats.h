@@ -0,0 +1,60 @@
+// File Name : memstats.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : allocation counters for the Huffman data structures
+// Data : 04/12/2022
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+//
+// What an allocation was for.  Each category keeps its own counters.
+//
+enum MemCategory {
+    MEM_HUFFMAN_NODE,  // HuffmanNode in buildEncodingTree()
+    MEM_HASHMAP_NODE,  // hashmap key_val_pair
+    MEM_MYMAP_NODE,  // mymap NODE
+    MEM_STRING_BUFFER,  // encode()/decode() result strings
+    MEM_BLOCK_BUFFER,  // block file coder buffers
+    MEM_BTREE_NODE,  // btreemap leaf or inner node
+    MEM_CATEGORIES
+};
+
+struct MemUsage {
+    long allocs[MEM_CATEGORIES];  // number of allocations
+    long bytes[MEM_CATEGORIES];  // bytes allocated
+    long frees[MEM_CATEGORIES];
+    long freedBytes[MEM_CATEGORIES];
+};
+
+// records an allocation or free in this thread's and the process counters
+void countAlloc(int category, long bytes);
+void countFree(int category, long bytes);
+
+// records that a growing buffer moved from oldCapacity to newCapacity bytes,
+// or was freed if newCapacity is 0
+void countGrowth(int category, long oldCapacity, long newCapacity);
+
+// counters of the calling thread, or of every thread, since start up.  Both
+// are cheap enough to take around every block.
+MemUsage threadMemUsage();
+MemUsage processMemUsage();
+
+// returns after - before
+MemUsage memDelta(const MemUsage &before, const MemUsage &after);
+
+// resident set size from /proc/self/status, 0 if it cannot be read
+long currentRssKB();
+long peakRssKB();
+
+// starts a new peak RSS measurement, where the kernel allows it
+void resetPeakRss();
+
+// adds the counters of usage to total
+void addMemUsage(MemUsage &total, const MemUsage &usage);
+
+// prints one line per category that allocated anything
+void printMemUsage(string stage, const MemUsage &usage);
@@ -10,6 +10,9 @@
 
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "memstats.h"
 
 using namespace std;
 
@@ -24,6 +27,15 @@ class mymap {
         int nL;  // number of nodes in left 
         int nR;  // number of nodes in right
         bool isThreaded;
+
+        static void* operator new(size_t size) {
+            countAlloc(MEM_MYMAP_NODE, size);
+            return ::operator new(size);
+        }
+        static void operator delete(void* p, size_t size) {
+            countFree(MEM_MYMAP_NODE, size);
+            ::operator delete(p);
+        }
     };
     NODE* root;  // pointer to root node of the
     int size;  // # of key/value pairs in the mymap
@@ -57,10 +69,20 @@ class mymap {
             return !curr;
         }
 
+        //
+        // value:
+        // Returns the value of the current node.
+        //
+        valueType value() {
+            return curr -> value;
+        }
+
         //
         // operator++:
         //
-        // This function should advance curr to the next in-order node.
+        // This function should advance curr to the next in-order node,
+        // following the thread when there is no right subtree, so no stack
+        // is needed.
         // O(logN)
         //
         iterator operator++() {
@@ -77,6 +99,24 @@ class mymap {
         }
     };
 
+    //
+    // keyrange:
+    // The keys from first up to but not including last, so a range of
+    // mymap works with a foreach loop.
+    //
+    struct keyrange {
+        iterator first;
+        iterator last;
+
+        iterator begin() {
+            return first;
+        }
+
+        iterator end() {
+            return last;
+        }
+    };
+
     //
     // _toString
     //
@@ -118,37 +158,29 @@ class mymap {
     //
     // Copys a node of a different BST tree and the calls itself
     // to copy the left and right pointer if exists. It then returns the new
-    // node created
-    NODE* _copy(NODE* thisNode, NODE* otherNode, NODE* prevNode) {
+    // node created.  after is the in-order successor of the copied subtree,
+    // where its last node threads to.
+    NODE* _copy(NODE* otherNode, NODE* after) {
         if (otherNode == nullptr) {
             return nullptr;
         }
 
-        thisNode = new NODE();
+        NODE* thisNode = new NODE();
         thisNode->key = otherNode->key;
         thisNode->value = otherNode->value;
-        thisNode->left = nullptr;
-        thisNode->right = nullptr;
         thisNode->nL = otherNode->nL;
         thisNode->nR = otherNode->nR;
         thisNode->isThreaded = otherNode->isThreaded;
 
-        if (otherNode->left != nullptr) {
-            thisNode->left = _copy(thisNode->left, otherNode->left, thisNode);
-            thisNode->right = prevNode;
-        }
-        if(otherNode->right != nullptr) {
-            if (otherNode->isThreaded && prevNode != nullptr) {
-                thisNode->right = prevNode->right;
-                prevNode->right = thisNode;
-            } else {
-                thisNode->right = _copy(thisNode->right, otherNode->right, thisNode);
-            }
+        thisNode->left = _copy(otherNode->left, thisNode);
+        if (otherNode->isThreaded) {
+            thisNode->right = after;
+        } else {
+            thisNode->right = _copy(otherNode->right, after);
         }
         return thisNode;
     }
 
-
     //
     // _checkBalance
     //
@@ -187,8 +219,10 @@ class mymap {
     // _rebalance
     //
     // uses a vector of nodes to create a balanced BST tree and returns the
-    // root of that tree
-    NODE* _rebalance(vector<NODE*>& v, NODE* &parent, int start, int end) {
+    // root of that tree.  after is the in-order successor of the last node
+    // in v, so nodes without a right child thread to the next node in v or
+    // to after.
+    NODE* _rebalance(vector<NODE*>& v, int start, int end, NODE* after) {
         if (start > end) {
             return nullptr;
         }
@@ -197,16 +231,12 @@ class mymap {
         midNode->nL = mid - start;
         midNode->nR = end - mid;
 
-        midNode->left = _rebalance(v, midNode, start, mid - 1);
+        midNode->left = _rebalance(v, start, mid - 1, after);
         if (end-mid == 0) {
             midNode->isThreaded = true;
-            if (parent != nullptr && parent->key >= midNode->key) {
-                midNode->right = parent;
-            } else {
-                midNode->right = nullptr;
-            }
+            midNode->right = (mid + 1 < (int)v.size()) ? v[mid + 1] : after;
         } else {
-            midNode->right = _rebalance(v, midNode, mid + 1, end);
+            midNode->right = _rebalance(v, mid + 1, end, after);
             midNode->isThreaded = false;
         }
         return midNode;
@@ -315,7 +345,7 @@ class mymap {
     // self-balancing BST.
     //
     mymap(const mymap& other) {
-        this->root = _copy(this->root, other.root, nullptr);
+        this->root = _copy(other.root, nullptr);
         this->size = other.size;
     }
 
@@ -329,7 +359,7 @@ class mymap {
     //
     mymap& operator=(const mymap& other) {
         this->clear();
-        this->root = _copy(this->root, other.root, nullptr);
+        this->root = _copy(other.root, nullptr);
         this->size = other.size;
         return *this;
     }
@@ -388,7 +418,10 @@ class mymap {
         if (violator != nullptr) {
             vector<NODE*> errors;
             _getVector(violator, errors);
-            NODE* newRoot = _rebalance(errors, violatorParent, 0, errors.size()-1);
+            // the last node has no right child, so its right is the thread
+            // out of the subtree
+            NODE* newRoot = _rebalance(errors, 0, errors.size()-1,
+                                       errors.back()->right);
             if (violatorParent == nullptr) {
                 root = newRoot;
             } else if (violatorParent->key < newRoot->key) {
@@ -477,12 +510,16 @@ class mymap {
     //
     // begin:
     //
-    // returns an iterator to the first in order NODE.
+    // returns an iterator to the first in order NODE, or end() if the
+    // mymap is empty.
     // Time complexity: O(logn), where n is total number of nodes in the
     // threaded, self-balancing BST
     //
     iterator begin() {
         NODE* curr = root;
+        if (curr == nullptr) {
+            return end();
+        }
         while (curr->left != nullptr) {
             curr = curr->left;
         }
@@ -501,6 +538,111 @@ class mymap {
         return iterator(nullptr);
     }
 
+    //
+    // lower_bound:
+    //
+    // returns an iterator to the first key that is not less than key, or
+    // end() if there is none.
+    // Time complexity: O(logn), where n is total number of nodes in the
+    // threaded, self-balancing BST
+    //
+    iterator lower_bound(keyType key) {
+        NODE* curr = root;
+        NODE* found = nullptr;
+        while (curr != nullptr) {
+            if (curr->key < key) {
+                curr = (curr->isThreaded) ? nullptr : curr->right;
+            } else {
+                found = curr;
+                curr = curr->left;
+            }
+        }
+        return iterator(found);
+    }
+
+    //
+    // upper_bound:
+    //
+    // returns an iterator to the first key greater than key, or end() if
+    // there is none.
+    // Time complexity: O(logn), where n is total number of nodes in the
+    // threaded, self-balancing BST
+    //
+    iterator upper_bound(keyType key) {
+        NODE* curr = root;
+        NODE* found = nullptr;
+        while (curr != nullptr) {
+            if (key < curr->key) {
+                found = curr;
+                curr = curr->left;
+            } else {
+                curr = (curr->isThreaded) ? nullptr : curr->right;
+            }
+        }
+        return iterator(found);
+    }
+
+    //
+    // range:
+    //
+    // returns the keys from lo up to but not including hi, in order, for a
+    // foreach loop.  Walking the range follows the threads.
+    // Time complexity: O(logn + m), where m is the number of keys in the
+    // range.
+    //
+    keyrange range(keyType lo, keyType hi) {
+        keyrange keys = {lower_bound(lo), lower_bound(hi)};
+        if (!(lo < hi)) {
+            keys.first = keys.last;
+        }
+        return keys;
+    }
+
+    //
+    // rank:
+    //
+    // returns the number of keys less than key, using the nL counts.
+    // Time complexity: O(logn), where n is total number of nodes in the
+    // threaded, self-balancing BST
+    //
+    int rank(keyType key) {
+        NODE* curr = root;
+        int less = 0;
+        while (curr != nullptr) {
+            if (curr->key < key) {
+                less += curr->nL + 1;
+                curr = (curr->isThreaded) ? nullptr : curr->right;
+            } else {
+                curr = curr->left;
+            }
+        }
+        return less;
+    }
+
+    //
+    // select:
+    //
+    // returns the key with k smaller keys, so select(0) is the smallest.
+    // Throws out_of_range if k is not below Size().
+    // Time complexity: O(logn), where n is total number of nodes in the
+    // threaded, self-balancing BST
+    //
+    keyType select(int k) {
+        if (k < 0 || k >= size) {
+            throw out_of_range("mymap::select");
+        }
+        NODE* curr = root;
+        while (k != curr->nL) {
+            if (k < curr->nL) {
+                curr = curr->left;
+            } else {
+                k -= curr->nL + 1;
+                curr = curr->right;
+            }
+        }
+        return curr->key;
+    }
+
     //
     // toString:
     //
@@ -0,0 +1,363 @@
+// File Name : pipeline.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : runs block jobs through separate reader, coder and writer
+//               threads connected by bounded ring buffers so disk and CPU
+//               work overlap
+// Data : 04/12/2022
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "memstats.h"
+
+using namespace std;
+
+//
+// ringbuffer:
+// A bounded first-in first-out queue of pointers.  push blocks while the
+// ring is full and pop blocks while it is empty.  After close, pop returns
+// false once the ring has been drained.
+//
+template<typename valueType>
+class ringbuffer {
+ public:
+    ringbuffer(int capacity) : slots(capacity) {
+        head = 0;
+        count = 0;
+        closed = false;
+        maxCount = 0;
+        stalls = 0;
+    }
+
+    void push(valueType value) {
+        unique_lock<mutex> lock(m);
+        if (count == (int)slots.size()) {
+            stalls++;
+            notFull.wait(lock, [this] { return count < (int)slots.size(); });
+        }
+        slots[(head + count) % slots.size()] = value;
+        count++;
+        maxCount = max(maxCount, count);
+        notEmpty.notify_one();
+    }
+
+    bool pop(valueType &value) {
+        unique_lock<mutex> lock(m);
+        notEmpty.wait(lock, [this] { return count > 0 || closed; });
+        if (count == 0) {
+            return false;
+        }
+        value = slots[head];
+        head = (head + 1) % slots.size();
+        count--;
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(m);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+    int highWater() {
+        lock_guard<mutex> lock(m);
+        return maxCount;
+    }
+
+    long fullStalls() {
+        lock_guard<mutex> lock(m);
+        return stalls;
+    }
+
+ private:
+    vector<valueType> slots;
+    int head;  // index of the oldest value
+    int count;  // number of values in the ring
+    bool closed;
+    int maxCount;  // most values ever queued at once
+    long stalls;  // pushes that had to wait for room
+    mutex m;
+    condition_variable notEmpty;
+    condition_variable notFull;
+};
+
+//
+// One block moving through the pipeline.  The reader fills input, the coder
+// turns it into output and the writer stores output (or copies the block
+// straight from the source when it is stored raw).
+//
+struct BlockJob {
+    long index;  // position of the block in the file
+    int type;  // block type, see blockfile.h
+    long rawOffset;  // offset of the block in the uncompressed data
+    long rawLength;
+    long sourceOffset;  // offset of the stored bytes in the input file
+    vector<char> input;
+    string output;
+    vector<uint32_t> seekBits;  // bit offset of each seek point in the block
+};
+
+struct PipelineStats {
+    int queueDepth;  // ring capacity between stages, 0 when serial
+    long bufferSize;  // bytes per block buffer
+    int nBuffers;  // block buffers in flight
+    bool usedUring;
+    long nBlocks;
+    double readSeconds;  // time each stage spent working
+    double codeSeconds;
+    double writeSeconds;
+    double wallSeconds;
+    int codeQueueHighWater;  // most blocks waiting for the coder
+    int writeQueueHighWater;  // most blocks waiting for the writer
+    long readerStalls;  // reader waited because the coder was behind
+    long coderStalls;  // coder waited because the writer was behind
+    MemUsage readMemory;  // allocations made by each stage
+    MemUsage codeMemory;
+    MemUsage writeMemory;
+    long peakRssKB;  // peak resident set size during the run
+};
+
+//
+// *This function returns zeroed stats.
+//
+PipelineStats emptyPipelineStats() {
+    PipelineStats stats = PipelineStats();
+    return stats;
+}
+
+//
+// *This function returns the seconds elapsed since start.
+//
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+           .count();
+}
+
+//
+// *This function prints the stats of one run.
+//
+void printPipelineStats(PipelineStats &stats) {
+    cout << "Blocks: " << stats.nBlocks
+         << ", buffers: " << stats.nBuffers << " x " << stats.bufferSize
+         << " bytes, queue depth: " << stats.queueDepth
+         << (stats.usedUring ? ", io_uring reads" : "") << endl;
+    cout << "Read: " << stats.readSeconds << "s, code: " << stats.codeSeconds
+         << "s, write: " << stats.writeSeconds << "s, wall: "
+         << stats.wallSeconds << "s" << endl;
+    cout << "Queue high water (code/write): " << stats.codeQueueHighWater
+         << "/" << stats.writeQueueHighWater << ", stalls (read/code): "
+         << stats.readerStalls << "/" << stats.coderStalls << endl;
+    cout << "Peak RSS: " << stats.peakRssKB << " KB" << endl;
+    printMemUsage("Read", stats.readMemory);
+    printMemUsage("Code", stats.codeMemory);
+    printMemUsage("Write", stats.writeMemory);
+}
+
+//
+// *This function returns the bytes a string of the given capacity has on
+// the heap.  Short strings are kept inside the string object, so an empty
+// string has a capacity without having allocated anything.
+//
+long heapCapacity(long capacity) {
+    return (capacity > (long)string().capacity()) ? capacity : 0;
+}
+
+//
+// *This function counts the block buffers of job that grew since their
+// capacities were inputCapacity and outputCapacity.  Recycled buffers only
+// grow while the pipeline warms up.
+//
+void countBufferGrowth(BlockJob &job, long inputCapacity, long outputCapacity) {
+    countGrowth(MEM_BLOCK_BUFFER, inputCapacity, job.input.capacity());
+    countGrowth(MEM_BLOCK_BUFFER, heapCapacity(outputCapacity),
+                heapCapacity(job.output.capacity()));
+}
+
+//
+// *This function counts the free of job's block buffers, which happens when
+// the pipeline ends, against the stages that grew them: the reader grows
+// input and the coder grows output.
+//
+void countBufferRelease(BlockJob &job, PipelineStats &stats) {
+    MemUsage before = threadMemUsage();
+    countGrowth(MEM_BLOCK_BUFFER, job.input.capacity(), 0);
+    MemUsage after = threadMemUsage();
+    addMemUsage(stats.readMemory, memDelta(before, after));
+    countGrowth(MEM_BLOCK_BUFFER, heapCapacity(job.output.capacity()), 0);
+    addMemUsage(stats.codeMemory, memDelta(after, threadMemUsage()));
+}
+
+typedef function<bool(BlockJob&)> ReadStage;
+typedef function<void(BlockJob&)> CodeStage;
+typedef function<void(BlockJob&)> WriteStage;
+
+//
+// *This function runs every block through read, code and write.  read
+// returns false when there are no more blocks.  With a queue depth of zero
+// the stages run one after another on the calling thread; otherwise each
+// stage gets its own thread and 2 * queueDepth + 1 buffers are recycled
+// between them.  Blocks reach the writer in the order they were read.  An
+// exception in any stage stops the pipeline and is rethrown here.
+//
+void runPipeline(ReadStage read, CodeStage code, WriteStage write,
+                 int queueDepth, PipelineStats &stats) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    stats.queueDepth = queueDepth;
+    resetPeakRss();
+    if (queueDepth <= 0) {
+        BlockJob job;
+        job.index = 0;
+        stats.nBuffers = 1;
+        while (true) {
+            chrono::steady_clock::time_point t = chrono::steady_clock::now();
+            MemUsage before = threadMemUsage();
+            long inputCapacity = job.input.capacity();
+            bool more = read(job);
+            countBufferGrowth(job, inputCapacity, job.output.capacity());
+            MemUsage after = threadMemUsage();
+            addMemUsage(stats.readMemory, memDelta(before, after));
+            stats.readSeconds += secondsSince(t);
+            if (!more) {
+                break;
+            }
+            t = chrono::steady_clock::now();
+            long outputCapacity = job.output.capacity();
+            code(job);
+            countBufferGrowth(job, job.input.capacity(), outputCapacity);
+            before = after;
+            after = threadMemUsage();
+            addMemUsage(stats.codeMemory, memDelta(before, after));
+            stats.codeSeconds += secondsSince(t);
+            t = chrono::steady_clock::now();
+            write(job);
+            addMemUsage(stats.writeMemory, memDelta(after, threadMemUsage()));
+            stats.writeSeconds += secondsSince(t);
+            stats.nBlocks++;
+            job.index++;
+        }
+        countBufferRelease(job, stats);
+        stats.wallSeconds = secondsSince(start);
+        stats.peakRssKB = peakRssKB();
+        return;
+    }
+
+    int nBuffers = 2 * queueDepth + 1;
+    vector<BlockJob> jobs(nBuffers);
+    ringbuffer<BlockJob*> freeJobs(nBuffers);
+    ringbuffer<BlockJob*> toCoder(queueDepth);
+    ringbuffer<BlockJob*> toWriter(queueDepth);
+    for (BlockJob &job : jobs) {
+        freeJobs.push(&job);
+    }
+    stats.nBuffers = nBuffers;
+
+    mutex errorLock;
+    exception_ptr error = nullptr;
+    bool failed = false;
+    // records the first exception and drains every stage
+    auto fail = [&](exception_ptr e) {
+        lock_guard<mutex> lock(errorLock);
+        if (!failed) {
+            error = e;
+            failed = true;
+        }
+    };
+    auto hasFailed = [&]() {
+        lock_guard<mutex> lock(errorLock);
+        return failed;
+    };
+
+    // each stage owns its thread, so its thread counters are its own
+    thread reader([&]() {
+        MemUsage before = threadMemUsage();
+        long index = 0;
+        BlockJob* job;
+        while (!hasFailed() && freeJobs.pop(job)) {
+            try {
+                job->index = index;
+                chrono::steady_clock::time_point t =
+                    chrono::steady_clock::now();
+                long inputCapacity = job->input.capacity();
+                bool more = read(*job);
+                countBufferGrowth(*job, inputCapacity, job->output.capacity());
+                stats.readSeconds += secondsSince(t);
+                if (!more) {
+                    break;
+                }
+            } catch (...) {
+                fail(current_exception());
+                break;
+            }
+            toCoder.push(job);
+            index++;
+        }
+        toCoder.close();
+        stats.readMemory = memDelta(before, threadMemUsage());
+    });
+    thread coder([&]() {
+        MemUsage before = threadMemUsage();
+        BlockJob* job;
+        while (toCoder.pop(job)) {
+            if (!hasFailed()) {
+                try {
+                    chrono::steady_clock::time_point t =
+                        chrono::steady_clock::now();
+                    long outputCapacity = job->output.capacity();
+                    code(*job);
+                    countBufferGrowth(*job, job->input.capacity(),
+                                      outputCapacity);
+                    stats.codeSeconds += secondsSince(t);
+                } catch (...) {
+                    fail(current_exception());
+                }
+            }
+            toWriter.push(job);
+        }
+        toWriter.close();
+        stats.codeMemory = memDelta(before, threadMemUsage());
+    });
+    MemUsage writerBefore = threadMemUsage();
+    BlockJob* job;
+    while (toWriter.pop(job)) {
+        if (!hasFailed()) {
+            try {
+                chrono::steady_clock::time_point t =
+                    chrono::steady_clock::now();
+                write(*job);
+                stats.writeSeconds += secondsSince(t);
+                stats.nBlocks++;
+            } catch (...) {
+                fail(current_exception());
+            }
+        }
+        freeJobs.push(job);
+    }
+    freeJobs.close();
+    stats.writeMemory = memDelta(writerBefore, threadMemUsage());
+    reader.join();
+    coder.join();
+    for (BlockJob &job : jobs) {
+        countBufferRelease(job, stats);
+    }
+
+    stats.codeQueueHighWater = toCoder.highWater();
+    stats.writeQueueHighWater = toWriter.highWater();
+    stats.readerStalls = toCoder.fullStalls();
+    stats.coderStalls = toWriter.fullStalls();
+    stats.wallSeconds = secondsSince(start);
+    stats.peakRssKB = peakRssKB();
+    if (error != nullptr) {
+        rethrow_exception(error);
+    }
+}
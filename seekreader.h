@@ -0,0 +1,345 @@
+// File Name : seekreader.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : random access reads into block files using their seek
+//               table, with an LRU cache of recently decoded spans
+// Data : 04/12/2022
+
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "blockfile.h"
+#include "mymap.h"
+
+const int DEFAULT_CACHE_SPANS = 64;
+
+//
+// lrucache:
+// Keeps the capacity most recently used values.  get and put are
+// O(log n); putting a new key into a full cache drops the least recently
+// used one.
+//
+template<typename keyType, typename valueType>
+class lrucache {
+ public:
+    lrucache(int capacity) {
+        this->capacity = max(1, capacity);
+        hits = 0;
+        misses = 0;
+    }
+
+    bool get(keyType key, valueType &value) {
+        auto found = lookup.find(key);
+        if (found == lookup.end()) {
+            misses++;
+            return false;
+        }
+        items.splice(items.begin(), items, found->second);
+        value = found->second->second;
+        hits++;
+        return true;
+    }
+
+    void put(keyType key, valueType value) {
+        auto found = lookup.find(key);
+        if (found != lookup.end()) {
+            found->second->second = value;
+            items.splice(items.begin(), items, found->second);
+            return;
+        }
+        items.push_front(make_pair(key, value));
+        lookup[key] = items.begin();
+        if ((int)items.size() > capacity) {
+            lookup.erase(items.back().first);
+            items.pop_back();
+        }
+    }
+
+    long hits;
+    long misses;
+
+ private:
+    int capacity;
+    list<pair<keyType, valueType> > items;  // most recently used first
+    map<keyType, typename list<pair<keyType, valueType> >::iterator> lookup;
+};
+
+class seekreader {
+ private:
+    struct BlockInfo {
+        bool loaded;
+        int type;
+        long rawLength;
+        long payloadOffset;
+        long payloadLength;
+        long bitsOffset;  // where the coded bits start, -1 until known
+        long spanLength;  // raw bytes per seek span, 0 until known
+    };
+
+    int fd;
+    struct stat opened;  // the file as it was when the index was read
+    long seekInterval;
+    long jumpSize;  // bytes between a block's tree and its first stream
+    vector<SeekBlock> index;
+    mymap<long, long> blockStarts;  // raw offset of each block -> block
+    vector<BlockInfo> blocks;
+    lrucache<pair<long, long>, shared_ptr<string> > spans;
+    lrucache<long, shared_ptr<blockdecoder> > decoders;
+
+    //
+    // _block
+    //
+    // reads the record header of block b the first time it is needed
+    BlockInfo& _block(long b) {
+        BlockInfo &info = blocks[b];
+        if (!info.loaded) {
+            char record[BLOCK_RECORD_SIZE];
+            preadAll(fd, record, BLOCK_RECORD_SIZE, index[b].recordOffset);
+            info.type = record[0];
+            info.rawLength = getU32(record + 1);
+            info.payloadLength = getU32(record + 5);
+            checkBlockRecord(info.type, info.rawLength, info.payloadLength);
+            info.payloadOffset = index[b].recordOffset + BLOCK_RECORD_SIZE;
+            info.bitsOffset = -1;
+            info.spanLength = 0;
+            info.loaded = true;
+        }
+        return info;
+    }
+
+    //
+    // _decoder
+    //
+    // returns the decoder of block b and the offset of its coded bits.  A
+    // block's decoder is kept while its spans are read, so its table is
+    // built once per block rather than once per span.
+    shared_ptr<blockdecoder> _decoder(long b, long &bitsOffset) {
+        BlockInfo &info = _block(b);
+        if (info.type == BLOCK_CODEBOOK) {
+            char ref[CODEBOOK_REF_SIZE];
+            preadAll(fd, ref, CODEBOOK_REF_SIZE, info.payloadOffset);
+            Codebook* book = getCodebook((unsigned char)ref[0]);
+            checkCodebookRef(book, ref + 1);
+            bitsOffset = info.payloadOffset + CODEBOOK_REF_SIZE + jumpSize;
+            return codebookDecoder(book);
+        }
+        shared_ptr<blockdecoder> decoder;
+        if (decoders.get(b, decoder) && info.bitsOffset >= 0) {
+            bitsOffset = info.bitsOffset;
+            return decoder;
+        }
+        string table;
+        table.resize(min(info.payloadLength, 2L + 5 * BYTE_VALUES));
+        preadAll(fd, &table[0], table.size(), info.payloadOffset);
+        HuffmanNode* root = nullptr;
+        info.bitsOffset = info.payloadOffset
+                          + readBlockTree(table.data(), table.size(), root)
+                          + jumpSize;
+        bitsOffset = info.bitsOffset;
+        decoder = make_shared<blockdecoder>(
+            shared_ptr<HuffmanNode>(root, freeTree));
+        decoders.put(b, decoder);
+        return decoder;
+    }
+
+    //
+    // _spanLength
+    //
+    // returns the raw bytes per seek span of block b.  Coded blocks of files
+    // with streams read it from the segment length in their jump table.
+    long _spanLength(long b) {
+        BlockInfo &info = _block(b);
+        if (info.spanLength == 0) {
+            info.spanLength = seekInterval;
+            if (info.type != BLOCK_RAW && jumpSize > 0) {
+                long bitsOffset;
+                _decoder(b, bitsOffset);
+                char segment[4];
+                preadAll(fd, segment, 4, bitsOffset - jumpSize);
+                info.spanLength = streamSpanLength(getU32(segment),
+                                                   seekInterval);
+            }
+        }
+        return info.spanLength;
+    }
+
+    //
+    // _span
+    //
+    // returns seek span k of block b, decoding it if it is not cached
+    shared_ptr<string> _span(long b, long k) {
+        shared_ptr<string> span;
+        if (spans.get(make_pair(b, k), span)) {
+            return span;
+        }
+        BlockInfo &info = _block(b);
+        long spanLength = _spanLength(b);
+        long rawStart = k * spanLength;
+        long rawLength = min(spanLength, info.rawLength - rawStart);
+        span = make_shared<string>();
+        span->resize(rawLength);
+        if (info.type == BLOCK_RAW) {
+            preadAll(fd, &(*span)[0], rawLength, info.payloadOffset + rawStart);
+        } else {
+            long bitsOffset;
+            shared_ptr<blockdecoder> decoder = _decoder(b, bitsOffset);
+            vector<uint32_t> &points = index[b].seekBits;
+            if (k >= (long)points.size()) {
+                throw runtime_error("Bad seek table!");
+            }
+            long firstBit = points[k];
+            long endByte = (k + 1 < (long)points.size())
+                           ? bitsOffset + (points[k + 1] + 7) / 8
+                           : info.payloadOffset + info.payloadLength;
+            long startByte = bitsOffset + firstBit / 8;
+            string bits;
+            bits.resize(endByte - startByte);
+            preadAll(fd, &bits[0], bits.size(), startByte);
+            decoder->decode(bits.data(), bits.size(), firstBit % 8,
+                            &(*span)[0], rawLength);
+        }
+        spans.put(make_pair(b, k), span);
+        return span;
+    }
+
+ public:
+    //
+    // constructor:
+    // Opens a block file and loads its seek table.  Up to cacheSpans decoded
+    // spans are kept for later reads.  Seek spans never cross streams, so
+    // interleaved files are read one stream at a time.  Throws unless the
+    // blocks of the table cover the data from offset 0 without gaps.
+    //
+    seekreader(string filename, int cacheSpans)
+        : spans(cacheSpans), decoders(cacheSpans) {
+        fd = openFile(filename, O_RDONLY);
+        try {
+            if (fstat(fd, &opened) != 0) {
+                throw runtime_error("Cannot stat " + filename);
+            }
+            readBlockIndex(fd, index, seekInterval);
+            char header[BLOCKFILE_HEADER_SIZE];
+            preadAll(fd, header, BLOCKFILE_HEADER_SIZE, 0);
+            jumpSize = streamJumpSize(blockStreams(header));
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        if (seekInterval <= 0) {
+            close(fd);
+            throw runtime_error(filename + " has no seek table");
+        }
+        BlockInfo empty = BlockInfo();
+        blocks.assign(index.size(), empty);
+        try {
+            long rawOffset = 0;
+            for (long b = 0; b < (long)index.size(); b++) {
+                if (index[b].rawOffset != rawOffset) {
+                    throw runtime_error("Bad seek table!");
+                }
+                rawOffset += _block(b).rawLength;
+                blockStarts.put(index[b].rawOffset, b);
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+
+    ~seekreader() {
+        close(fd);
+    }
+
+    //
+    // current:
+    // Returns true if filename is still the file this reader opened, with
+    // the same size and modification time, so its index is still valid.
+    //
+    bool current(string filename) {
+        struct stat now;
+        return stat(filename.c_str(), &now) == 0
+               && now.st_dev == opened.st_dev && now.st_ino == opened.st_ino
+               && now.st_size == opened.st_size
+               && now.st_mtim.tv_sec == opened.st_mtim.tv_sec
+               && now.st_mtim.tv_nsec == opened.st_mtim.tv_nsec;
+    }
+
+    //
+    // size:
+    // Returns the size of the uncompressed data.
+    //
+    long size() {
+        if (index.empty()) {
+            return 0;
+        }
+        return index.back().rawOffset + _block(index.size() - 1).rawLength;
+    }
+
+    //
+    // read:
+    // Returns up to length uncompressed bytes starting at offset.  Only the
+    // seek spans that overlap the range are decoded.  Throws if offset or
+    // length is negative.
+    //
+    string read(long offset, long length) {
+        if (offset < 0 || length < 0) {
+            throw invalid_argument("Bad range!");
+        }
+        string out;
+        long end = (length > size() - offset) ? size() : offset + length;
+        while (offset < end) {
+            // the block holding offset is the last one starting at or
+            // before it, and blocks are numbered in offset order
+            long b = blockStarts.rank(offset + 1) - 1;
+            long inBlock = offset - index[b].rawOffset;
+            long spanLength = _spanLength(b);
+            long k = inBlock / spanLength;
+            shared_ptr<string> span = _span(b, k);
+            long inSpan = inBlock - k * spanLength;
+            long n = min(end - offset, (long)span->size() - inSpan);
+            if (n <= 0) {
+                throw runtime_error("Bad seek table!");
+            }
+            out.append(*span, inSpan, n);
+            offset += n;
+        }
+        return out;
+    }
+
+    long cacheHits() {
+        return spans.hits;
+    }
+
+    long cacheMisses() {
+        return spans.misses;
+    }
+};
+
+//
+// *This function reads length bytes at offset of the uncompressed contents
+// of a block file.  Readers stay open between calls so repeated reads of
+// the same file are served from the decoded span cache.  A reader whose
+// file was appended to, rewritten or replaced since it was opened is
+// closed and the file opened again.
+//
+string readRange(string filename, long offset, long length) {
+    static mymap<string, seekreader*> readers;
+    seekreader* reader = readers.get(filename);
+    if (reader != nullptr && !reader->current(filename)) {
+        delete reader;
+        reader = nullptr;
+        readers.put(filename, nullptr);
+    }
+    if (reader == nullptr) {
+        reader = new seekreader(filename, DEFAULT_CACHE_SPANS);
+        readers.put(filename, reader);
+    }
+    return reader->read(offset, length);
+}
@@ -0,0 +1,319 @@
+// File Name : snapshotmap.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : a mymap that many threads can read without locking.
+//               Readers use an immutable snapshot; writers publish a new
+//               one and free old ones once no reader can still see them.
+// Data : 04/12/2022
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "mymap.h"
+
+using namespace std;
+
+const int MAX_EPOCH_THREADS = 256;
+const unsigned long EPOCH_IDLE = ~0UL;  // slot of a thread that is not reading
+
+//
+// epochdomain:
+// Epoch based reclamation shared by every snapshotmap.  A reading thread
+// stores the global epoch in its own slot while it reads and EPOCH_IDLE
+// afterwards.  Writers retire an old snapshot at the current epoch and
+// advance it; the snapshot can be freed once every slot is idle or newer,
+// since readers that started after the advance only see the new snapshot.
+// Each slot has its own cache line, so readers never write to memory
+// another reader uses.
+//
+class epochdomain {
+ public:
+    //
+    // global:
+    // Returns the domain every snapshotmap uses.
+    //
+    static epochdomain& global() {
+        static epochdomain domain;
+        return domain;
+    }
+
+    //
+    // enter:
+    // Marks the calling thread as reading.  Calls nest.
+    //
+    void enter() {
+        ThreadSlot &owner = _owner();
+        if (owner.depth++ == 0) {
+            slots[owner.slot].epoch.store(epoch.load());
+        }
+    }
+
+    //
+    // leave:
+    // Ends the read started by the matching enter().
+    //
+    void leave() {
+        ThreadSlot &owner = _owner();
+        if (--owner.depth == 0) {
+            slots[owner.slot].epoch.store(EPOCH_IDLE, memory_order_release);
+        }
+    }
+
+    //
+    // advance:
+    // Starts a new epoch and returns the one that ended, which is the
+    // epoch to retire a just replaced snapshot at.
+    //
+    unsigned long advance() {
+        return epoch.fetch_add(1);
+    }
+
+    //
+    // safe:
+    // Returns true if no thread is reading in retired or an earlier epoch.
+    //
+    bool safe(unsigned long retired) {
+        for (int s = 0; s < MAX_EPOCH_THREADS; s++) {
+            if (slots[s].epoch.load() <= retired) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+ private:
+    struct alignas(64) Slot {
+        atomic<unsigned long> epoch;
+        atomic<bool> used;
+    };
+
+    //
+    // ThreadSlot:
+    // The slot a thread claimed the first time it read, given back when
+    // the thread exits.
+    //
+    struct ThreadSlot {
+        int slot;
+        int depth;  // enter() calls without a leave()
+
+        ThreadSlot() {
+            depth = 0;
+            slot = epochdomain::global()._claim();
+        }
+        ~ThreadSlot() {
+            epochdomain::global()._release(slot);
+        }
+    };
+
+    Slot slots[MAX_EPOCH_THREADS];
+    atomic<unsigned long> epoch;
+
+    epochdomain() {
+        epoch.store(0);
+        for (int s = 0; s < MAX_EPOCH_THREADS; s++) {
+            slots[s].epoch.store(EPOCH_IDLE);
+            slots[s].used.store(false);
+        }
+    }
+
+    //
+    // _owner
+    //
+    // returns the calling thread's slot, claiming one on first use
+    ThreadSlot& _owner() {
+        static thread_local ThreadSlot owner;
+        return owner;
+    }
+
+    //
+    // _claim
+    //
+    // takes a free slot.  Throws if more than MAX_EPOCH_THREADS threads
+    // read at once.
+    int _claim() {
+        for (int s = 0; s < MAX_EPOCH_THREADS; s++) {
+            bool expected = false;
+            if (slots[s].used.compare_exchange_strong(expected, true)) {
+                return s;
+            }
+        }
+        throw runtime_error("Too many snapshotmap reader threads!");
+    }
+
+    //
+    // _release
+    //
+    // gives a slot back
+    void _release(int slot) {
+        slots[slot].epoch.store(EPOCH_IDLE);
+        slots[slot].used.store(false);
+    }
+};
+
+//
+// epochguard:
+// Keeps the calling thread inside the epoch domain while it is in scope.
+//
+class epochguard {
+ public:
+    epochguard() {
+        epochdomain::global().enter();
+    }
+    ~epochguard() {
+        epochdomain::global().leave();
+    }
+};
+
+//
+// snapshotmap:
+// A map of key/value pairs, like mymap, that any number of threads may
+// read while others write.  Reads go to the current snapshot, a mymap that
+// is never changed once published, and take no lock.  Writers copy the
+// snapshot, change the copy and swap it in under a mutex, so writes are
+// O(n) and meant for maps that are read far more than written; putAll
+// applies many changes for the cost of one copy.
+//
+template<typename keyType, typename valueType>
+class snapshotmap {
+ public:
+    //
+    // default constructor:
+    //
+    // Creates an empty snapshotmap.
+    //
+    snapshotmap() {
+        current.store(new mymap<keyType, valueType>());
+        reclaimed = 0;
+    }
+
+    //
+    // destructor:
+    //
+    // Frees every snapshot.  No thread may still be reading.
+    //
+    ~snapshotmap() {
+        delete current.load();
+        for (Retired &old : retired) {
+            delete old.second;
+        }
+    }
+
+    snapshotmap(const snapshotmap&) = delete;
+    snapshotmap& operator=(const snapshotmap&) = delete;
+
+    //
+    // get:
+    //
+    // Returns the value for the given key, or valueType() if the key is not
+    // found.  Lock free.
+    // Time complexity: O(logn)
+    //
+    valueType get(keyType key) {
+        epochguard guard;
+        return current.load()->get(key);
+    }
+
+    //
+    // contains:
+    //
+    // Returns true if the key is in the snapshotmap.  Lock free.
+    // Time complexity: O(logn)
+    //
+    bool contains(keyType key) {
+        epochguard guard;
+        return current.load()->contains(key);
+    }
+
+    //
+    // Size:
+    //
+    // Returns the # of key/value pairs in the current snapshot.
+    //
+    int Size() {
+        epochguard guard;
+        return current.load()->Size();
+    }
+
+    //
+    // toVector:
+    //
+    // Returns the pairs of one snapshot, in order.
+    // Time complexity: O(n)
+    //
+    vector<pair<keyType, valueType> > toVector() {
+        epochguard guard;
+        return current.load()->toVector();
+    }
+
+    //
+    // put:
+    //
+    // Inserts the key/value, or replaces the value, in a new snapshot.
+    // Time complexity: O(n)
+    //
+    void put(keyType key, valueType value) {
+        vector<pair<keyType, valueType> > pairs;
+        pairs.push_back(make_pair(key, value));
+        putAll(pairs);
+    }
+
+    //
+    // putAll:
+    //
+    // Inserts every pair in a single new snapshot, so readers see all of
+    // them or none.
+    // Time complexity: O(n + m logn), where m is the number of pairs.
+    //
+    void putAll(const vector<pair<keyType, valueType> > &pairs) {
+        lock_guard<mutex> lock(writeLock);
+        mymap<keyType, valueType>* next =
+            new mymap<keyType, valueType>(*current.load());
+        for (const pair<keyType, valueType> &p : pairs) {
+            next->put(p.first, p.second);
+        }
+        mymap<keyType, valueType>* old = current.exchange(next);
+        retired.push_back(Retired(epochdomain::global().advance(), old));
+        _reclaim();
+    }
+
+    //
+    // reclaimedCount:
+    //
+    // Returns the number of old snapshots freed so far.
+    //
+    long reclaimedCount() {
+        lock_guard<mutex> lock(writeLock);
+        return reclaimed;
+    }
+
+ private:
+    typedef pair<unsigned long, mymap<keyType, valueType>*> Retired;
+
+    atomic<mymap<keyType, valueType>*> current;
+    mutex writeLock;  // one writer at a time
+    vector<Retired> retired;  // replaced snapshots and their epochs
+    long reclaimed;
+
+    //
+    // _reclaim
+    //
+    // frees the retired snapshots no reader can still be using.  Called
+    // with writeLock held.
+    void _reclaim() {
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (epochdomain::global().safe(retired[i].first)) {
+                delete retired[i].second;
+                reclaimed++;
+            } else {
+                retired[kept++] = retired[i];
+            }
+        }
+        retired.resize(kept);
+    }
+};
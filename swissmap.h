@@ -0,0 +1,299 @@
+// File Name : swissmap.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : an open addressing hash map of any key and value types.
+//               Slots are found by comparing 16 control bytes at a time.
+// Data : 04/12/2022
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+const int SWISS_GROUP = 16;  // control bytes compared at once
+const int8_t SWISS_EMPTY = -128;  // control byte of an empty slot
+
+//
+// swissmap:
+// Keys and values are stored inline in one slot array.  A parallel array
+// holds one control byte per slot: SWISS_EMPTY, or 7 bits of the key's hash
+// when the slot is full.  A lookup starts at the key's home slot and
+// compares the control bytes of SWISS_GROUP slots with one SSE2 instruction,
+// only comparing keys whose hash bits match, until a group has an empty
+// slot.  Probing is linear, so removing a key shifts the keys after it back
+// instead of leaving a tombstone, and lookups never slow down after many
+// removals.  The table grows at 7/8 full.  Keys and values must be default
+// constructible and copyable; Hash is any std::hash like function object.
+//
+template<typename keyType, typename valueType,
+         typename Hash = hash<keyType> >
+class swissmap {
+ public:
+    //
+    // default constructor:
+    //
+    // Creates an empty swissmap.  Nothing is allocated until the first put.
+    //
+    swissmap() {
+        nElems = 0;
+    }
+
+    //
+    // get:
+    //
+    // Returns the value for key, or valueType() if key is not in the map.
+    //
+    valueType get(const keyType &key) const {
+        long slot = _find(key);
+        return (slot < 0) ? valueType() : slots[slot].second;
+    }
+
+    //
+    // containsKey:
+    //
+    // Returns true if key is in the map.
+    //
+    bool containsKey(const keyType &key) const {
+        return _find(key) >= 0;
+    }
+
+    //
+    // put:
+    //
+    // Inserts key with value, or replaces the value if key is already in
+    // the map.
+    //
+    void put(const keyType &key, const valueType &value) {
+        long slot = _find(key);
+        if (slot >= 0) {
+            slots[slot].second = value;
+            return;
+        }
+        if ((long)(nElems + 1) * 8 > (long)slots.size() * 7) {
+            _rehash(slots.empty() ? SWISS_GROUP : slots.size() * 2);
+        }
+        uint64_t h = _mix(key);
+        size_t pos = _home(h);
+        uint32_t empty;
+        while ((empty = _match(pos, SWISS_EMPTY)) == 0) {
+            pos = (pos + SWISS_GROUP) & mask;
+        }
+        slot = (pos + __builtin_ctz(empty)) & mask;
+        slots[slot] = make_pair(key, value);
+        _setControl(slot, h & 0x7F);
+        nElems++;
+    }
+
+    //
+    // remove:
+    //
+    // Removes key and returns true, or returns false if it is not in the
+    // map.  Keys later in the probe run move back into the gap, unless that
+    // would put them before their home slot.
+    //
+    bool remove(const keyType &key) {
+        long gap = _find(key);
+        if (gap < 0) {
+            return false;
+        }
+        size_t next = gap;
+        while (true) {
+            next = (next + 1) & mask;
+            if (control[next] == SWISS_EMPTY) {
+                break;
+            }
+            size_t home = _home(_mix(slots[next].first));
+            // the key at next may fill the gap if its home is not in
+            // (gap, next], taking wrap around into account
+            bool stays = (gap <= (long)next)
+                         ? ((long)home > gap && home <= next)
+                         : ((long)home > gap || home <= next);
+            if (!stays) {
+                slots[gap] = slots[next];
+                _setControl(gap, control[next]);
+                gap = next;
+            }
+        }
+        slots[gap] = pair<keyType, valueType>();
+        _setControl(gap, SWISS_EMPTY);
+        nElems--;
+        return true;
+    }
+
+    //
+    // keys:
+    //
+    // Returns every key, in slot order.
+    //
+    vector<keyType> keys() const {
+        vector<keyType> out;
+        out.reserve(nElems);
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (control[i] != SWISS_EMPTY) {
+                out.push_back(slots[i].first);
+            }
+        }
+        return out;
+    }
+
+    //
+    // size:
+    //
+    // Returns the number of keys in the map.
+    //
+    int size() const {
+        return nElems;
+    }
+
+    //
+    // reserve:
+    //
+    // Grows the table so n keys fit without rehashing.
+    //
+    void reserve(long n) {
+        size_t capacity = SWISS_GROUP;
+        while ((long)capacity * 7 < n * 8) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            _rehash(capacity);
+        }
+    }
+
+    //
+    // clear:
+    //
+    // Removes every key and frees the table.
+    //
+    void clear() {
+        slots.clear();
+        control.clear();
+        nElems = 0;
+    }
+
+ private:
+    vector<pair<keyType, valueType> > slots;
+    // one byte per slot, then the first SWISS_GROUP bytes again so a group
+    // starting near the end can be loaded without wrapping
+    vector<int8_t> control;
+    size_t mask;  // slots.size() - 1
+    int nElems;
+    Hash hasher;
+
+    //
+    // _mix
+    //
+    // spreads the bits of the key's hash, since std::hash of an integer is
+    // the integer itself
+    uint64_t _mix(const keyType &key) const {
+        uint64_t h = hasher(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    //
+    // _home
+    //
+    // returns the first slot to probe for hash h; the low 7 bits go in the
+    // control byte instead
+    size_t _home(uint64_t h) const {
+        return (h >> 7) & mask;
+    }
+
+    //
+    // _match
+    //
+    // returns a bit mask with bit i set where the control byte of slot
+    // pos + i equals value
+    uint32_t _match(size_t pos, int8_t value) const {
+#ifdef __SSE2__
+        __m128i group = _mm_loadu_si128((const __m128i*)(control.data() + pos));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value)));
+#else
+        uint32_t bits = 0;
+        for (int i = 0; i < SWISS_GROUP; i++) {
+            bits |= (uint32_t)(control[pos + i] == value) << i;
+        }
+        return bits;
+#endif
+    }
+
+    //
+    // _find
+    //
+    // returns the slot holding key, or -1
+    long _find(const keyType &key) const {
+        if (nElems == 0) {
+            return -1;
+        }
+        uint64_t h = _mix(key);
+        int8_t tag = h & 0x7F;
+        size_t pos = _home(h);
+        while (true) {
+            uint32_t candidates = _match(pos, tag);
+            while (candidates != 0) {
+                size_t slot = (pos + __builtin_ctz(candidates)) & mask;
+                if (slots[slot].first == key) {
+                    return slot;
+                }
+                candidates &= candidates - 1;
+            }
+            // keys are never past an empty slot of their probe run
+            if (_match(pos, SWISS_EMPTY) != 0) {
+                return -1;
+            }
+            pos = (pos + SWISS_GROUP) & mask;
+        }
+    }
+
+    //
+    // _setControl
+    //
+    // sets the control byte of slot and its copy past the end
+    void _setControl(size_t slot, int8_t value) {
+        control[slot] = value;
+        if (slot < (size_t)SWISS_GROUP) {
+            control[slots.size() + slot] = value;
+        }
+    }
+
+    //
+    // _rehash
+    //
+    // moves every key into a table of capacity slots, a power of two
+    void _rehash(size_t capacity) {
+        vector<pair<keyType, valueType> > old;
+        old.swap(slots);
+        vector<int8_t> oldControl;
+        oldControl.swap(control);
+        slots.resize(capacity);
+        control.assign(capacity + SWISS_GROUP, SWISS_EMPTY);
+        mask = capacity - 1;
+        for (size_t i = 0; i < old.size(); i++) {
+            if (oldControl[i] == SWISS_EMPTY) {
+                continue;
+            }
+            uint64_t h = _mix(old[i].first);
+            size_t pos = _home(h);
+            uint32_t empty;
+            while ((empty = _match(pos, SWISS_EMPTY)) == 0) {
+                pos = (pos + SWISS_GROUP) & mask;
+            }
+            size_t slot = (pos + __builtin_ctz(empty)) & mask;
+            slots[slot] = old[i];
+            _setControl(slot, h & 0x7F);
+        }
+    }
+};
@@ -0,0 +1,213 @@
+// File Name : uring.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : reads one large buffer as many chunked reads kept in
+//               flight at once through io_uring, with a pread fallback
+// Data : 04/12/2022
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+using namespace std;
+
+const long URING_CHUNK_SIZE = 128 * 1024;
+
+//
+// *This function reads exactly length bytes at offset with pread.
+//
+void preadAll(int fd, char* data, long length, long offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, data, length, offset);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw runtime_error("Read failed!");
+        }
+        data += n;
+        length -= n;
+        offset += n;
+    }
+}
+
+class uringreader {
+ public:
+    //
+    // constructor:
+    // Sets up a ring with room for depth reads.  If io_uring is not
+    // available (old kernel, blocked by seccomp, not compiled in) the
+    // reader falls back to pread and usingUring() returns false.
+    //
+    uringreader(int depth) {
+        ringFd = -1;
+        this->depth = depth;
+#ifdef HAVE_IO_URING
+        memset(&params, 0, sizeof(params));
+        if (depth <= 0) {
+            return;
+        }
+        int fd = syscall(__NR_io_uring_setup, depth, &params);
+        if (fd < 0) {
+            return;
+        }
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqSize = params.cq_off.cqes
+                 + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) {
+            sqSize = cqSize = max(sqSize, cqSize);
+        }
+        sqRing = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cqRing = single ? sqRing
+                 : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        sqeSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqeMap = mmap(nullptr, sqeSize, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED
+            || sqeMap == MAP_FAILED) {
+            // unmap whichever mappings did succeed before falling back
+            if (sqeMap != MAP_FAILED) {
+                munmap(sqeMap, sqeSize);
+            }
+            if (cqRing != MAP_FAILED && cqRing != sqRing) {
+                munmap(cqRing, cqSize);
+            }
+            if (sqRing != MAP_FAILED) {
+                munmap(sqRing, sqSize);
+            }
+            close(fd);
+            return;
+        }
+        sqes = (struct io_uring_sqe*)sqeMap;
+        char* sq = (char*)sqRing;
+        char* cq = (char*)cqRing;
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+        this->depth = min((unsigned)depth, params.sq_entries);
+        ringFd = fd;
+#endif
+    }
+
+    ~uringreader() {
+#ifdef HAVE_IO_URING
+        if (ringFd >= 0) {
+            munmap(sqes, sqeSize);
+            if (cqRing != sqRing) {
+                munmap(cqRing, cqSize);
+            }
+            munmap(sqRing, sqSize);
+            close(ringFd);
+        }
+#endif
+    }
+
+    bool usingUring() {
+        return ringFd >= 0;
+    }
+
+    //
+    // readAt:
+    // Reads exactly length bytes at offset into data, split into chunks of
+    // URING_CHUNK_SIZE with up to depth chunks in flight.  Short reads are
+    // finished with pread.
+    //
+    void readAt(int fd, char* data, long length, long offset) {
+#ifdef HAVE_IO_URING
+        if (ringFd < 0) {
+            preadAll(fd, data, length, offset);
+            return;
+        }
+        long nChunks = (length + URING_CHUNK_SIZE - 1) / URING_CHUNK_SIZE;
+        long next = 0;
+        int inFlight = 0;
+        int toSubmit = 0;  // queued entries the kernel has not taken yet
+        while (next < nChunks || inFlight > 0) {
+            while (next < nChunks && inFlight < depth) {
+                unsigned tail = *sqTail;
+                unsigned index = tail & sqMask;
+                struct io_uring_sqe* sqe = &sqes[index];
+                long chunkOffset = next * URING_CHUNK_SIZE;
+                memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = fd;
+                sqe->addr = (unsigned long)(data + chunkOffset);
+                sqe->len = min(URING_CHUNK_SIZE, length - chunkOffset);
+                sqe->off = offset + chunkOffset;
+                sqe->user_data = next;
+                sqArray[index] = index;
+                __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+                next++;
+                inFlight++;
+                toSubmit++;
+            }
+            int n = syscall(__NR_io_uring_enter, ringFd, toSubmit, 1,
+                            IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n < 0 && errno != EINTR) {
+                throw runtime_error("io_uring_enter failed!");
+            }
+            if (n > 0) {
+                toSubmit -= n;
+            }
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail) {
+                struct io_uring_cqe* cqe = &cqes[head & cqMask];
+                long chunkOffset = cqe->user_data * URING_CHUNK_SIZE;
+                long want = min(URING_CHUNK_SIZE, length - chunkOffset);
+                long got = cqe->res < 0 ? 0 : cqe->res;
+                if (got < want) {
+                    preadAll(fd, data + chunkOffset + got, want - got,
+                             offset + chunkOffset + got);
+                }
+                head++;
+                inFlight--;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+#else
+        preadAll(fd, data, length, offset);
+#endif
+    }
+
+ private:
+    int ringFd;
+    int depth;  // most chunk reads in flight
+#ifdef HAVE_IO_URING
+    struct io_uring_params params;
+    void* sqRing;
+    void* cqRing;
+    size_t sqSize;
+    size_t cqSize;
+    size_t sqeSize;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    unsigned* sqTail;
+    unsigned* sqArray;
+    unsigned sqMask;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+#endif
+};
@@ -13,18 +13,53 @@
 #include <vector>         // std::vector
 #include <functional>     // std::greater
 #include <string>
+#include <thread>
+#include <iterator>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "bitbuffer.h"
 #include "bitstream.h"
 #include "hashmap.h"
+#include "memstats.h"
 #include "mymap.h"
 #pragma once
 
 struct HuffmanNode {
     int character;
-    int count;
+    long count;
     HuffmanNode* zero;
     HuffmanNode* one;
+
+    // counted so memory use per stage can be reported, see memstats.h
+    static void* operator new(size_t size) {
+        countAlloc(MEM_HUFFMAN_NODE, size);
+        return ::operator new(size);
+    }
+    static void operator delete(void* p, size_t size) {
+        countFree(MEM_HUFFMAN_NODE, size);
+        ::operator delete(p);
+    }
 };
 
+// Largest total a tree is built from.  Huffman codes can only get longer
+// than 64 bits, the widest code table entry, when the counts add up to
+// more than about 2^44, so larger totals are scaled down first.
+const long MAX_TREE_TOTAL = 1L << 40;
+
+//
+// Defined in codebook.h.  Returns the shared tree of a trained codebook
+// after checking it against the hash stored in the file.
+//
+HuffmanNode* codebookTree(int id, const char* hashBytes);
+
+//
+// Defined in histogram.h.  Counts a file on nThreads threads.
+//
+bool buildParallelFrequencyMap(string filename, int nThreads, hashmap &map);
+
 
 //
 // *This function checks to see if the current node
@@ -52,11 +87,43 @@ void freeTree(HuffmanNode* node) {
     _delete(node);
 }
 
+//
+// *This function scales the counts of map down so they add up to at most
+// maxTotal.  Counts keep their order and never drop below one, so every
+// symbol stays codable.  Maps within the limit are left alone.
+//
+void rescaleFrequencyMap(hashmap &map, long maxTotal) {
+    vector<int> keys = map.keys();
+    long total = 0;
+    for (int key : keys) {
+        total += map.get(key);
+    }
+    if (total <= maxTotal) {
+        return;
+    }
+    // the ones added by the max below are what the margin leaves room for
+    long margin = maxTotal - (long)keys.size();
+    long divisor = total / max(margin, 1L) + 1;
+    for (int key : keys) {
+        map.put(key, max(map.get(key) / divisor, 1L));
+    }
+}
+
 //
 // *This function build the frequency map.  If isFile is true, then it reads
 // from filename.  If isFile is false, then it reads from a string filename.
+// Files are counted on every core when map starts out empty.  Counts are
+// scaled down to MAX_TREE_TOTAL if needed; the header then stores the
+// scaled counts, so decompress() builds the same tree.
 //
 void buildFrequencyMap(string filename, bool isFile, hashmap &map) {
+    if (isFile && map.size() == 0
+        && buildParallelFrequencyMap(filename,
+                                     thread::hardware_concurrency(), map)) {
+        map.put(256, 1);
+        rescaleFrequencyMap(map, MAX_TREE_TOTAL);
+        return;
+    }
     if (isFile) {
         ifstream inFS(filename);
         char c;
@@ -77,6 +144,7 @@ void buildFrequencyMap(string filename, bool isFile, hashmap &map) {
         }
     }
     map.put(256, 1);
+    rescaleFrequencyMap(map, MAX_TREE_TOTAL);
 }
 
 class prioritize {
@@ -144,6 +212,15 @@ mymap <int, string> buildEncodingMap(HuffmanNode* tree) {
     return encodingMap;
 }
 
+//
+// *This function frees a string returned by encode() or decode(), whose
+// growth they counted, and counts the free.
+//
+void releaseString(string &str) {
+    countGrowth(MEM_STRING_BUFFER, str.capacity(), 0);
+    string().swap(str);
+}
+
 //
 // *This function encodes the data in the input stream into the output stream
 // using the encodingMap.  This function calculates the number of bits
@@ -152,13 +229,17 @@ mymap <int, string> buildEncodingMap(HuffmanNode* tree) {
 // the output file, which is particularly useful for testing.
 //
 string encode(ifstream& input, mymap <int, string> &encodingMap,
-              ofbitstream& output, int &size, bool makeFile) {
+              ofbitstream& output, long &size, bool makeFile) {
     string str = "";
     char c;
+    long capacity = 0;
     while (input.get(c)) {
         str += encodingMap.get((int)c);
+        countGrowth(MEM_STRING_BUFFER, capacity, str.capacity());
+        capacity = str.capacity();
     }
     str += encodingMap.get(256);
+    countGrowth(MEM_STRING_BUFFER, capacity, str.capacity());
     if (makeFile) {
         for (char c : str) {
             if (c == '1') {
@@ -172,6 +253,38 @@ string encode(ifstream& input, mymap <int, string> &encodingMap,
     return str;  // TO DO: update this return
 }
 
+//
+// *This function writes the code of every byte of input, then the code of
+// PSEUDO_EOF, to output like encode() does, but never holds the bits as a
+// string, so memory use does not grow with the input.  Returns the number
+// of bits written.
+//
+long encodeStream(ifstream &input, mymap<int, string> &encodingMap,
+                  ofbitstream &output) {
+    // codes by unsigned byte value, so the map is searched once per symbol
+    vector<string> codes(PSEUDO_EOF + 1);
+    for (int i = 0; i < PSEUDO_EOF; i++) {
+        if (encodingMap.contains((int)(char)i)) {
+            codes[i] = encodingMap.get((int)(char)i);
+        }
+    }
+    codes[PSEUDO_EOF] = encodingMap.get(PSEUDO_EOF);
+    long bits = 0;
+    char buffer[64 * 1024];
+    while (input.read(buffer, sizeof(buffer)) || input.gcount() > 0) {
+        for (long i = 0; i < input.gcount(); i++) {
+            const string &code = codes[(unsigned char)buffer[i]];
+            for (char bit : code) {
+                output.writeBit(bit == '1' ? 1 : 0);
+            }
+            bits += code.length();
+        }
+    }
+    for (char bit : codes[PSEUDO_EOF]) {
+        output.writeBit(bit == '1' ? 1 : 0);
+    }
+    return bits + codes[PSEUDO_EOF].length();
+}
 
 //
 // *This function decodes the input stream and writes the result to the output
@@ -181,6 +294,7 @@ string encode(ifstream& input, mymap <int, string> &encodingMap,
 string decode(ifbitstream &input, HuffmanNode* encodingTree, ofstream &output) {
     string str = "";
     HuffmanNode* root = encodingTree;
+    long capacity = 0;
     while (!input.eof()) {
         int bit = input.readBit();
         if (encodingTree->character == 256) {
@@ -192,6 +306,8 @@ string decode(ifbitstream &input, HuffmanNode* encodingTree, ofstream &output) {
         }
         if (encodingTree->character != 256 && encodingTree->character != 257) {
             str += encodingTree->character;
+            countGrowth(MEM_STRING_BUFFER, capacity, str.capacity());
+            capacity = str.capacity();
             encodingTree = root;
         }
     }
@@ -201,25 +317,163 @@ string decode(ifbitstream &input, HuffmanNode* encodingTree, ofstream &output) {
     return str;  // TO DO: update this return
 }
 
+//
+// *This function decodes like decode(), but reads the rest of input into
+// memory first and takes the bits from a bitreader instead of calling
+// readBit() on the stream for every bit.  Decoded bytes are written out in
+// chunks instead of being kept.  Returns the number of bytes decoded.
+//
+long decodeBuffered(ifbitstream &input, HuffmanNode* encodingTree,
+                    ofstream &output) {
+    string bits((istreambuf_iterator<char>(input)),
+                istreambuf_iterator<char>());
+    bitreader reader(bits.data(), bits.size());
+    char chunk[64 * 1024];
+    long n = 0;
+    long total = 0;
+    HuffmanNode* curr = encodingTree;
+    while (curr->character == NOT_A_CHAR) {
+        int bit = reader.readBit();
+        if (bit == EOF) {
+            break;
+        }
+        curr = (bit == 1) ? curr->one : curr->zero;
+        if (curr->character == PSEUDO_EOF) {
+            break;
+        } else if (curr->character != NOT_A_CHAR) {
+            chunk[n++] = (char)curr->character;
+            if (n == (long)sizeof(chunk)) {
+                output.write(chunk, n);
+                total += n;
+                n = 0;
+            }
+            curr = encodingTree;
+        }
+    }
+    output.write(chunk, n);
+    return total + n;
+}
+
+//
+// *This function returns the exact size of a compressed file: the header,
+// then the code of every counted symbol, PSEUDO_EOF included, rounded up
+// to whole bytes.
+//
+long compressedSize(hashmap &frequencyMap, mymap<int, string> &encodingMap) {
+    stringstream header;
+    header << frequencyMap;
+    long bits = 0;
+    for (int key : frequencyMap.keys()) {
+        bits += frequencyMap.get(key) * (long)encodingMap.get(key).length();
+    }
+    return header.str().length() + (bits + 7) / 8;
+}
+
 //
 // *This function completes the entire compression process.  Given a file,
 // filename, this function (1) builds a frequency map; (2) builds an encoding
 // tree; (3) builds an encoding map; (4) encodes the file (don't forget to
 // include the frequency map in the header of the output file).  This function
-// should create a compressed file named (filename + ".huf") and should also
-// return a string version of the bit pattern.
+// should create a compressed file named (filename + ".huf") and returns its
+// size in bytes.  The bits are streamed to the file, see encodeStream().
 //
-string compress(string filename) {
+long compress(string filename) {
     hashmap frequencyMap;
     buildFrequencyMap(filename, true, frequencyMap);
     HuffmanNode* tree = buildEncodingTree(frequencyMap);
     mymap<int, string> encodingMap = buildEncodingMap(tree);
+    long size = compressedSize(frequencyMap, encodingMap);
     ofbitstream output(filename + ".huf");
+    output.reserve(size);
     output << frequencyMap;
     ifstream input(filename);
     freeTree(tree);
-    int size = 0;
-    return encode(input, encodingMap, output, size, true);
+    encodeStream(input, encodingMap, output);
+    return size;
+}
+
+//
+// *This function decodes the bits of inName from byte offset on into
+// outName.  The output file is sized to length, the uncompressed size from
+// the header, and mapped so symbols are written straight into it; the input
+// is mapped too.  If the header counts were scaled down (see
+// MAX_TREE_TOTAL) the output is grown until PSEUDO_EOF is found, and it is
+// always trimmed to what was decoded.  Returns the number of bytes decoded;
+// they are only ever in the mapping, never copied.
+//
+long decodeMapped(string inName, long offset, HuffmanNode* encodingTree,
+                    string outName, long length) {
+    int inFd = open(inName.c_str(), O_RDONLY);
+    int outFd = open(outName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (inFd < 0 || outFd < 0) {
+        if (inFd >= 0) {
+            close(inFd);
+        }
+        if (outFd >= 0) {
+            close(outFd);
+        }
+        throw runtime_error("Cannot open " + inName);
+    }
+    struct stat info;
+    fstat(inFd, &info);
+    long inSize = info.st_size;
+    char* in = nullptr;
+    if (inSize > offset) {
+        in = (char*)mmap(nullptr, inSize, PROT_READ, MAP_PRIVATE, inFd, 0);
+        if (in == MAP_FAILED) {
+            close(inFd);
+            close(outFd);
+            throw runtime_error("Cannot map " + inName);
+        }
+        madvise(in, inSize, MADV_SEQUENTIAL);
+    }
+    bitreader reader(in + offset, max(inSize - offset, 0L));
+    long capacity = 0;
+    char* out = nullptr;
+    long n = 0;
+    HuffmanNode* curr = encodingTree;
+    bool ok = true;
+    while (curr->character != PSEUDO_EOF) {
+        if (curr->character != NOT_A_CHAR) {
+            if (n == capacity) {
+                // the first pass sizes the file exactly; growing only
+                // happens for scaled headers
+                if (out != nullptr) {
+                    munmap(out, capacity);
+                }
+                capacity = (capacity == 0) ? max(length, 4096L) : 2 * capacity;
+                out = (ftruncate(outFd, capacity) != 0) ? (char*)MAP_FAILED
+                      : (char*)mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, outFd, 0);
+                if (out == MAP_FAILED) {
+                    ok = false;
+                    out = nullptr;
+                    break;
+                }
+            }
+            out[n++] = (char)curr->character;
+            curr = encodingTree;
+            continue;
+        }
+        int bit = reader.readBit();
+        if (bit == EOF) {
+            break;
+        }
+        curr = (bit == 1) ? curr->one : curr->zero;
+    }
+    if (out != nullptr) {
+        munmap(out, capacity);
+    }
+    if (in != nullptr) {
+        munmap(in, inSize);
+    }
+    ok = (ftruncate(outFd, n) == 0) && ok;
+    close(inFd);
+    close(outFd);
+    if (!ok) {
+        throw runtime_error("Cannot write " + outName);
+    }
+    return n;
 }
 
 //
@@ -229,21 +483,47 @@ string compress(string filename) {
 // using the encoding tree to decode the file.  This function should create a
 // compressed file using the following convention.
 // If filename = "example.txt.huf", then the uncompressed file should be named
-// "example_unc.txt".  The function should return a string version of the
-// uncompressed file.  Note: this function should reverse what the compress
-// function did.
+// "example_unc.txt".  The function returns the size of the uncompressed
+// file.  Note: this function should reverse what the compress function did.
 //
-string decompress(string filename) {
+long decompress(string filename) {
+    string inName = filename;
     ifbitstream input(filename);
+    if (input.fail()) {
+        throw runtime_error("Cannot open " + filename);
+    }
     size_t pos = filename.find(".txt.huf");
     if ((int)pos >= 0) {
         filename = filename.substr(0, pos);
     }
-    ofstream output(filename + "_unc.txt");
+    if (input.peek() == '@') {
+        // header-free file written with a trained codebook, so its size is
+        // not known up front
+        ofstream output(filename + "_unc.txt");
+        input.get();
+        int id = (unsigned char)input.get();
+        char hashBytes[4];
+        input.read(hashBytes, 4);
+        HuffmanNode* codebook = codebookTree(id, hashBytes);
+        return decodeBuffered(input, codebook, output);
+    }
     hashmap frequencyMap;
     input >> frequencyMap;
+    long offset = input.tellg();
+    input.close();
+    long length = 0;
+    for (int key : frequencyMap.keys()) {
+        length += (key == PSEUDO_EOF) ? 0 : frequencyMap.get(key);
+    }
     HuffmanNode* encodingTree = buildEncodingTree(frequencyMap);
-    string str = decode(input, encodingTree, output);
+    long size;
+    try {
+        size = decodeMapped(inName, offset, encodingTree,
+                            filename + "_unc.txt", length);
+    } catch (...) {
+        freeTree(encodingTree);
+        throw;
+    }
     freeTree(encodingTree);
-    return str;
+    return size;
 }
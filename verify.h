@@ -0,0 +1,113 @@
+// File Name : verify.h
+// Name : Moe Judeh
+// netID : mjude4
+// Course Info : CS 251 - Data Structures (34460)
+// Description : checks block files while they are written by decoding
+//               every coded block in memory on the worker pool
+// Data : 04/12/2022
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include "blockfile.h"
+#include "checksum.h"
+#include "jobpool.h"
+
+using namespace std;
+
+//
+// blockverifier:
+// Given to compressBlocks or appendBlocks through BlockOptions::verify.
+// Each coded block is copied and handed to the worker pool, which decodes
+// it in memory and compares the SHA-256 of the result with that of the
+// source bytes, so the coder only pays for the copy.  Raw blocks are copied
+// from the input as they are and are not checked.  At most two checks per
+// worker are in flight; the coder waits on the oldest beyond that, which
+// also keeps the copies from piling up.  A failed check throws from the
+// coder, which stops the pipeline, or from finish(), which writeBlocks
+// calls before the index is written.
+//
+class blockverifier : public blockchecker {
+ public:
+    blockverifier(workerpool &pool) : pool(pool) {
+        verified = 0;
+    }
+
+    //
+    // check:
+    // Queues the round trip of one block of a file with nStreams streams.
+    //
+    void check(const BlockJob &job, int nStreams) override {
+        if (job.type == BLOCK_RAW) {
+            return;
+        }
+        shared_ptr<BlockJob> copy = make_shared<BlockJob>();
+        copy->type = job.type;
+        copy->rawOffset = job.rawOffset;
+        copy->rawLength = job.rawLength;
+        copy->input = job.input;
+        copy->output = job.output;
+        jobhandle handle = pool.submitTask(
+            [copy, nStreams](BlockJob &scratch, const atomic<bool>*) {
+                scratch.type = copy->type;
+                scratch.rawLength = copy->rawLength;
+                scratch.input.assign(copy->output.begin(), copy->output.end());
+                decodeBlockJob(scratch, nullptr, nStreams);
+                if (sha256(scratch.output.data(), scratch.output.size())
+                    != sha256(copy->input.data(), copy->rawLength)) {
+                    throw runtime_error("Block at offset "
+                                        + to_string(copy->rawOffset)
+                                        + " failed verification!");
+                }
+                return string();
+            }, PRIORITY_HIGH);
+        lock_guard<mutex> lock(m);
+        pending.push_back(handle);
+        while ((int)pending.size() > 2 * pool.size()) {
+            _waitOldest();
+        }
+    }
+
+    //
+    // finish:
+    // Waits for every queued check and returns the number of blocks
+    // verified.  Throws if a block did not round trip.
+    //
+    long finish() override {
+        lock_guard<mutex> lock(m);
+        while (!pending.empty()) {
+            _waitOldest();
+        }
+        return verified;
+    }
+
+    //
+    // verifiedCount:
+    // Returns the number of blocks verified so far.
+    //
+    long verifiedCount() {
+        lock_guard<mutex> lock(m);
+        return verified;
+    }
+
+ private:
+    workerpool &pool;
+    mutex m;
+    deque<jobhandle> pending;  // checks in submission order
+    long verified;
+
+    //
+    // _waitOldest
+    //
+    // waits for the oldest queued check.  Called with m held.
+    void _waitOldest() {
+        jobhandle oldest = pending.front();
+        pending.pop_front();
+        oldest.get();
+        verified++;
+    }
+};